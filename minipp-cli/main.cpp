@@ -0,0 +1,463 @@
+// minipp-cli: query and maintain mini files from the shell.
+//
+//   minipp-cli get <file> <path>              prints the value at section.sub.key (strings unquoted)
+//   minipp-cli set <file> <path> <value>      value in mini syntax, e.g. "text", 12, 0Ch, 1.5f, true, [1, 2];
+//                                             missing sections are created
+//   minipp-cli validate [--schema <schema>] <file>...
+//                                             exit code 0 if all files parse (and match the schema)
+//   minipp-cli format <file>                  rewrites the file in canonical form
+//   minipp-cli diff <a> <b>                   structural diff, exit code 1 if the files differ
+//   minipp-cli bench <file> [iterations]      parse / write timings
+//
+// <file> may be - for stdin. set and format write back into the file (to stdout for -), or to -o <path>.
+// Exit codes: 0 success, 1 error or difference, 2 bad usage.
+// Compressed files (.gz, .zst) are read and written as such when built with MINIPP_WITH_ZLIB / MINIPP_WITH_ZSTD.
+//
+// Outside of Visual Studio: g++ -std=c++14 -O2 -I../minipp main.cpp -o minipp-cli -pthread
+
+#define MINIPP_DEBUG_STREAM std::cerr
+#define MINIPP_IMPLEMENTATION
+#include "minipp.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace minipp;
+
+namespace
+{
+	const char* ResultName(EResult result)
+	{
+		switch (result)
+		{
+		case EResult::KeyNotPresent: return "KeyNotPresent";
+		case EResult::KeyAlreadyPresent: return "KeyAlreadyPresent";
+		case EResult::SectionNotPresent: return "SectionNotPresent";
+		case EResult::SectionAlreadyPresent: return "SectionAlreadyPresent";
+		case EResult::FileIOError: return "FileIOError";
+		case EResult::InvalidDataType: return "InvalidDataType";
+		case EResult::FormatError: return "FormatError";
+		case EResult::ArrayDataTypeInconsistency: return "ArrayDataTypeInconsistency";
+		case EResult::BadEscapeSequence: return "BadEscapeSequence";
+		case EResult::UnknownEscapeSequence: return "UnknownEscapeSequence";
+		case EResult::UnescapedStringValue: return "UnescapedStringValue";
+		case EResult::ValueEmpty: return "ValueEmpty";
+		case EResult::IntegerValueInvalid: return "IntegerValueInvalid";
+		case EResult::IntegerValueOutOfRange: return "IntegerValueOutOfRange";
+		case EResult::IntegerStyleInvalid: return "IntegerStyleInvalid";
+		case EResult::FloatValueInvalid: return "FloatValueInvalid";
+		case EResult::BooleanValueInvalid: return "BooleanValueInvalid";
+		case EResult::ArrayNotEnclosed: return "ArrayNotEnclosed";
+		case EResult::ArrayBracketsInbalanced: return "ArrayBracketsInbalanced";
+		case EResult::InvalidName: return "InvalidName";
+		case EResult::SectionExpectedClosingBracket: return "SectionExpectedClosingBracket";
+		case EResult::EmptySectionName: return "EmptySectionName";
+		case EResult::KeyValuePairNotInSection: return "KeyValuePairNotInSection";
+		case EResult::ExpectedKeyValuePair: return "ExpectedKeyValuePair";
+		case EResult::KeyEmpty: return "KeyEmpty";
+		case EResult::MissingQuote: return "MissingQuote";
+		case EResult::IndexOutOfRange: return "IndexOutOfRange";
+		case EResult::BufferTooSmall: return "BufferTooSmall";
+		case EResult::SchemaViolation: return "SchemaViolation";
+		case EResult::Success: return "Success";
+		case EResult::ValueOverwritten: return "ValueOverwritten";
+		}
+		return "Unknown";
+	}
+
+	int Fail(const std::string& what, EResult result)
+	{
+		std::cerr << "minipp: " << what << ": " << ResultName(result) << std::endl;
+		return 1;
+	}
+
+	int Usage()
+	{
+		std::cerr <<
+			"usage: minipp-cli get <file> <path>\n"
+			"       minipp-cli set <file> <path> <value> [-o <out>]\n"
+			"       minipp-cli validate [--schema <schema>] <file>...\n"
+			"       minipp-cli format <file> [-o <out>]\n"
+			"       minipp-cli diff <a> <b>\n"
+			"       minipp-cli bench <file> [iterations]\n"
+			"<file> may be - for stdin\n";
+		return 2;
+	}
+
+	EResult Load(const std::string& path, MiniPPFile& file, const MiniPPFile::ParseOptions& options)
+	{
+		if (path == "-")
+			return file.Parse(std::cin, options);
+
+		// by path, so .gz / .zst files are decompressed (see MiniPPFile::Codec)
+		return file.Parse(path, options);
+	}
+
+	EResult Store(const MiniPPFile& file, const std::string& path)
+	{
+		if (path != "-")
+			return file.WriteMapped(path);
+
+		String buffer;
+		EResult result = file.WriteToBuffer(buffer);
+		if (!MiniPPFile::IsResultOk(result))
+			return result;
+		std::cout.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		std::cout.flush();
+		return std::cout.fail() ? EResult::FileIOError : EResult::Success;
+	}
+
+	std::string ValueText(const MiniPPFile::Value* value)
+	{
+		String text;
+		value->ToString(text);
+		return std::string(text.data(), text.size());
+	}
+
+	template<typename Map>
+	std::vector<std::string> SortedKeys(const Map& map)
+	{
+		std::vector<std::string> keys;
+		keys.reserve(map.size());
+		for (auto& pair : map)
+			keys.emplace_back(pair.first.data(), pair.first.size());
+		std::sort(keys.begin(), keys.end());
+		return keys;
+	}
+
+	// same rule as the parser: [a - z][A - Z][0 - 9] and _
+	bool IsName(const String& name)
+	{
+		if (name.empty())
+			return false;
+		for (char c : name)
+		{
+			if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_'))
+				return false;
+		}
+		return true;
+	}
+
+	std::string Join(const std::string& path, const std::string& name)
+	{
+		return path.empty() ? name : path + "." + name;
+	}
+
+	// Prints "- path = old" / "+ path = new" lines, sections that exist on one side only as "- [path]" / "+ [path]"
+	bool DiffSections(const MiniPPFile::Section* a, const MiniPPFile::Section* b, const std::string& path)
+	{
+		bool differs = false;
+
+		auto keysA = SortedKeys(a->GetValues());
+		auto keysB = SortedKeys(b->GetValues());
+		std::vector<std::string> keys;
+		std::set_union(keysA.begin(), keysA.end(), keysB.begin(), keysB.end(), std::back_inserter(keys));
+		for (auto& key : keys)
+		{
+			auto itA = a->GetValues().find(String(key.data(), key.size()));
+			auto itB = b->GetValues().find(String(key.data(), key.size()));
+			std::string textA = itA != a->GetValues().end() ? ValueText(itA->second) : std::string();
+			std::string textB = itB != b->GetValues().end() ? ValueText(itB->second) : std::string();
+			if (itA != a->GetValues().end() && itB != b->GetValues().end() && textA == textB)
+				continue;
+
+			differs = true;
+			if (itA != a->GetValues().end())
+				std::cout << "- " << Join(path, key) << " = " << textA << "\n";
+			if (itB != b->GetValues().end())
+				std::cout << "+ " << Join(path, key) << " = " << textB << "\n";
+		}
+
+		auto sectionsA = SortedKeys(a->GetSubSections());
+		auto sectionsB = SortedKeys(b->GetSubSections());
+		std::vector<std::string> sections;
+		std::set_union(sectionsA.begin(), sectionsA.end(), sectionsB.begin(), sectionsB.end(), std::back_inserter(sections));
+		for (auto& name : sections)
+		{
+			auto itA = a->GetSubSections().find(String(name.data(), name.size()));
+			auto itB = b->GetSubSections().find(String(name.data(), name.size()));
+			if (itA == a->GetSubSections().end())
+			{
+				std::cout << "+ [" << Join(path, name) << "]\n";
+				differs = true;
+			}
+			else if (itB == b->GetSubSections().end())
+			{
+				std::cout << "- [" << Join(path, name) << "]\n";
+				differs = true;
+			}
+			else if (DiffSections(itA->second, itB->second, Join(path, name)))
+				differs = true;
+		}
+		return differs;
+	}
+
+	int Get(const std::string& path, const std::string& key)
+	{
+		MiniPPFile file;
+		MiniPPFile::ParseOptions options;
+		options.lazyArrayThreshold = 4096; // only the requested value matters
+		EResult result = Load(path, file, options);
+		if (!MiniPPFile::IsResultOk(result))
+			return Fail(path, result);
+
+		MiniPPFile::Value* value = nullptr;
+		result = file.GetRoot().GetValue(String(key.data(), key.size()), &value);
+		if (!MiniPPFile::IsResultOk(result))
+			return Fail(key, result);
+
+		auto stringValue = dynamic_cast<MiniPPFile::Values::StringValue*>(value);
+		if (stringValue != nullptr)
+			std::cout.write(stringValue->GetValue().data(), static_cast<std::streamsize>(stringValue->GetValue().size()));
+		else
+			std::cout << ValueText(value);
+		std::cout << "\n";
+		return 0;
+	}
+
+	int Set(const std::string& path, const std::string& key, const std::string& text, const std::string& output)
+	{
+		MiniPPFile file;
+		MiniPPFile::ParseOptions options;
+		options.reserveFromPreScan = true;
+		EResult result = Load(path, file, options);
+		if (!MiniPPFile::IsResultOk(result))
+			return Fail(path, result);
+
+		std::unique_ptr<MiniPPFile::Value> value = MiniPPFile::Value::ParseValue(String(text.data(), text.size()), &result);
+		if (value == nullptr)
+			return Fail(text, result);
+
+		size_t separator = key.rfind('.');
+		if (separator == std::string::npos)
+			return Fail(key, EResult::KeyValuePairNotInSection);
+
+		MiniPPFile::Section* section = &file.GetRoot();
+		size_t begin = 0;
+		while (begin < separator)
+		{
+			size_t end = std::min(key.find('.', begin), separator);
+			String name(key.data() + begin, end - begin);
+			if (!IsName(name))
+				return Fail(key, EResult::InvalidName);
+			section->EmplaceSubSection(std::move(name), &section);
+			begin = end + 1;
+		}
+
+		String name(key.data() + separator + 1, key.size() - separator - 1);
+		if (!IsName(name))
+			return Fail(key, name.empty() ? EResult::KeyEmpty : EResult::InvalidName);
+
+		// the comments above the old value stay where they were
+		auto existing = section->GetValues().find(name);
+		if (existing != section->GetValues().end())
+			value->GetComments() = std::move(existing->second->GetComments());
+
+		result = section->SetValue(std::move(name), std::move(value), true);
+		if (!MiniPPFile::IsResultOk(result))
+			return Fail(key, result);
+
+		result = Store(file, output.empty() ? path : output);
+		return MiniPPFile::IsResultOk(result) ? 0 : Fail(output.empty() ? path : output, result);
+	}
+
+	int Validate(int count, char** paths)
+	{
+		MiniPPFile::Schema schema;
+		MiniPPFile::ParseOptions options;
+		options.reserveFromPreScan = true;
+		if (count >= 1 && std::strcmp(paths[0], "--schema") == 0)
+		{
+			if (count < 3)
+				return Usage();
+			EResult result = schema.Parse(paths[1]);
+			if (!MiniPPFile::IsResultOk(result))
+				return Fail(paths[1], result);
+			options.schema = &schema;
+			count -= 2;
+			paths += 2;
+		}
+
+		int exitCode = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			MiniPPFile file;
+			EResult result = Load(paths[i], file, options);
+			if (MiniPPFile::IsResultOk(result))
+				std::cout << paths[i] << ": ok\n";
+			else
+				exitCode = Fail(paths[i], result);
+		}
+		return exitCode;
+	}
+
+	int Format(const std::string& path, const std::string& output)
+	{
+		MiniPPFile file;
+		MiniPPFile::ParseOptions options;
+		options.reserveFromPreScan = true;
+		EResult result = Load(path, file, options);
+		if (!MiniPPFile::IsResultOk(result))
+			return Fail(path, result);
+
+		result = Store(file, output.empty() ? path : output);
+		return MiniPPFile::IsResultOk(result) ? 0 : Fail(output.empty() ? path : output, result);
+	}
+
+	int Diff(const std::string& pathA, const std::string& pathB)
+	{
+		if (pathA == "-" && pathB == "-")
+			return Usage();
+
+		MiniPPFile a;
+		MiniPPFile b;
+		MiniPPFile::ParseOptions options;
+		options.reserveFromPreScan = true;
+		EResult result = Load(pathA, a, options);
+		if (!MiniPPFile::IsResultOk(result))
+			return Fail(pathA, result);
+		result = Load(pathB, b, options);
+		if (!MiniPPFile::IsResultOk(result))
+			return Fail(pathB, result);
+
+		return DiffSections(&a.GetRoot(), &b.GetRoot(), std::string()) ? 1 : 0;
+	}
+
+	struct Timing
+	{
+		double best = 0.0;
+		double total = 0.0;
+
+		void Add(double seconds, int iteration)
+		{
+			best = iteration == 0 ? seconds : std::min(best, seconds);
+			total += seconds;
+		}
+
+		void Print(const char* name, size_t bytes, int iterations) const
+		{
+			std::cout << name << ": best " << best * 1000.0 << " ms, mean " << total * 1000.0 / iterations << " ms, "
+				<< (best > 0.0 ? bytes / best / (1024.0 * 1024.0) : 0.0) << " MiB/s\n";
+		}
+	};
+
+	int Bench(const std::string& path, int iterations)
+	{
+		// the input is read (and decompressed) once, so the timings are parser / serializer time and not disk
+		// or codec time
+		std::string source;
+		{
+			std::ostringstream buffer;
+			MiniPPFile::Codec codec;
+			if (path == "-")
+				buffer << std::cin.rdbuf();
+			else if (MiniPPFile::FindCodec(path, &codec))
+			{
+				std::ifstream ifs(path, std::ios::binary);
+				if (!ifs.is_open() || codec.createDecoder == nullptr)
+					return Fail(path, EResult::FileIOError);
+				MiniPPFile::DecodingStreamBuffer decoded(ifs, codec.createDecoder());
+				buffer << &decoded;
+				if (!MiniPPFile::IsResultOk(decoded.GetResult()))
+					return Fail(path, decoded.GetResult());
+			}
+			else
+			{
+				std::ifstream ifs(path, std::ios::binary);
+				if (!ifs.is_open())
+					return Fail(path, EResult::FileIOError);
+				buffer << ifs.rdbuf();
+			}
+			source = buffer.str();
+		}
+
+		using Clock = std::chrono::steady_clock;
+		auto seconds = [](Clock::time_point begin) { return std::chrono::duration<double>(Clock::now() - begin).count(); };
+
+		Timing parse, parsePreScan, measure, write;
+		size_t writtenBytes = 0;
+		for (int i = 0; i < iterations; ++i)
+		{
+			{
+				MiniPPFile file;
+				std::istringstream input(source);
+				auto begin = Clock::now();
+				EResult result = file.Parse(input);
+				parse.Add(seconds(begin), i);
+				if (!MiniPPFile::IsResultOk(result))
+					return Fail(path, result);
+			}
+
+			MiniPPFile file;
+			MiniPPFile::ParseOptions options;
+			options.reserveFromPreScan = true;
+			std::istringstream input(source);
+			auto begin = Clock::now();
+			EResult result = file.Parse(input, options);
+			parsePreScan.Add(seconds(begin), i);
+			if (!MiniPPFile::IsResultOk(result))
+				return Fail(path, result);
+
+			begin = Clock::now();
+			writtenBytes = file.MeasureSerializedSize();
+			measure.Add(seconds(begin), i);
+
+			String buffer;
+			begin = Clock::now();
+			result = file.WriteToBuffer(buffer);
+			write.Add(seconds(begin), i);
+			if (!MiniPPFile::IsResultOk(result))
+				return Fail(path, result);
+		}
+
+		std::cout << path << ": " << source.size() << " bytes, " << iterations << " iterations\n";
+		parse.Print("parse", source.size(), iterations);
+		parsePreScan.Print("parse (pre-scan)", source.size(), iterations);
+		measure.Print("measure", writtenBytes, iterations);
+		write.Print("write", writtenBytes, iterations);
+		return 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::ios::sync_with_stdio(false);
+	if (argc < 3)
+		return Usage();
+
+	std::string command = argv[1];
+
+	// -o <out> may follow the positional arguments of set and format
+	std::string output;
+	if (argc >= 5 && std::strcmp(argv[argc - 2], "-o") == 0)
+	{
+		output = argv[argc - 1];
+		argc -= 2;
+	}
+
+	if (command == "get" && argc == 4)
+		return Get(argv[2], argv[3]);
+	if (command == "set" && argc == 5)
+		return Set(argv[2], argv[3], argv[4], output);
+	if (command == "validate" && output.empty())
+		return Validate(argc - 2, argv + 2);
+	if (command == "format" && argc == 3)
+		return Format(argv[2], output);
+	if (command == "diff" && argc == 4 && output.empty())
+		return Diff(argv[2], argv[3]);
+	if (command == "bench" && (argc == 3 || argc == 4) && output.empty())
+	{
+		int iterations = argc == 4 ? std::atoi(argv[3]) : 10;
+		return iterations > 0 ? Bench(argv[2], iterations) : Usage();
+	}
+	return Usage();
+}
@@ -19,14 +19,70 @@
 */
 
 // enabled helpful debug messages via std::cout (for parsing and writing)
-#define MINIPP_ENABLE_DEBUG_OUTPUT true
+#ifndef MINIPP_ENABLE_DEBUG_OUTPUT
+	#define MINIPP_ENABLE_DEBUG_OUTPUT true
+#endif
+// where the debug messages go, e.g. std::cerr to keep them out of piped output
+#ifndef MINIPP_DEBUG_STREAM
+	#define MINIPP_DEBUG_STREAM std::cout
+#endif
+
+// routes all Value allocations through MiniPPFile::ValuePool (see MiniPPFile::EnableValuePool)
+#ifndef MINIPP_ENABLE_VALUE_POOL
+	#define MINIPP_ENABLE_VALUE_POOL false
+#endif
+
+// built-in codecs for compressed files (see MiniPPFile::Codec), link zlib / libzstd when enabling them
+#ifndef MINIPP_WITH_ZLIB
+	#define MINIPP_WITH_ZLIB false
+#endif
+#ifndef MINIPP_WITH_ZSTD
+	#define MINIPP_WITH_ZSTD false
+#endif
+
+// C++17: allocates the whole document (nodes, strings, maps, vectors) from a std::pmr::memory_resource
+// (see MiniPPFile::MiniPPFile(std::pmr::memory_resource*) and MiniPPFile::ResourceScope)
+#ifndef MINIPP_USE_PMR
+	#define MINIPP_USE_PMR false
+#endif
 
 #include <cstdint>
+#include <atomic>
+#include <mutex>
 #include <unordered_map>
 #include <string>
 #include <memory>
 #include <utility>
 #include <vector>
+#include <iosfwd>
+#include <streambuf>
+#include <type_traits>
+#include <limits>
+
+#if (defined(_MSVC_LANG) ? _MSVC_LANG : __cplusplus) >= 201703L
+	#define MINIPP_HAS_CPP17 true
+	#include <string_view>
+#else
+	#define MINIPP_HAS_CPP17 false
+#endif
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+#if MINIPP_USE_PMR
+	#if !MINIPP_HAS_CPP17
+		#error "MINIPP_USE_PMR requires C++17"
+	#endif
+	#include <memory_resource>
+
+	// passes the active memory resource to document containers that are constructed or copied
+	#define MINIPP_DOCUMENT_ALLOCATOR , ::minipp::detail::GetMemoryResource()
+	#define MINIPP_DOCUMENT_ALLOCATOR_INIT { ::minipp::detail::GetMemoryResource() }
+#else
+	#define MINIPP_DOCUMENT_ALLOCATOR
+	#define MINIPP_DOCUMENT_ALLOCATOR_INIT
+#endif
 
 namespace minipp
 {
@@ -59,6 +115,9 @@ namespace minipp
 		ExpectedKeyValuePair			= -24,
 		KeyEmpty						= -25,
 		MissingQuote					= -26,
+		IndexOutOfRange					= -27,
+		BufferTooSmall					= -28,
+		SchemaViolation					= -29,
 
 		/* OK Codes */
 		Success							= +1,
@@ -72,25 +131,212 @@ namespace minipp
 		Binary
 	};
 
+	enum class EValueType
+	{
+		String,
+		Int,
+		Boolean,
+		Float,
+		Array
+	};
+
+	enum class ESimdLevel
+	{
+		Scalar,
+		SSE42,
+		AVX2,
+		AVX512
+	};
+
+#if MINIPP_USE_PMR
+	using String = std::pmr::string;
+	template<typename T>
+	using Vector = std::pmr::vector<T>;
+	template<typename Key, typename T>
+	using HashMap = std::pmr::unordered_map<Key, T>;
+#else
+	using String = std::string;
+	template<typename T>
+	using Vector = std::vector<T>;
+	template<typename Key, typename T>
+	using HashMap = std::unordered_map<Key, T>;
+#endif
+
+	namespace detail
+	{
+#if MINIPP_USE_PMR
+		// resource of the innermost MiniPPFile::ResourceScope on this thread, std::pmr::get_default_resource() otherwise
+		std::pmr::memory_resource* GetMemoryResource() noexcept;
+
+		inline std::string ToStdString(const String& str) { return std::string(str); }
+#else
+		inline const std::string& ToStdString(const String& str) noexcept { return str; }
+#endif
+
+		// frees the capacity of a document container without changing its allocator
+		template<typename Container>
+		void ReleaseStorage(Container& container) noexcept
+		{
+			Container(container.get_allocator()).swap(container);
+		}
+
+		// swapping containers with unequal (pmr) allocators is undefined, their elements are moved across instead
+		template<typename Container>
+		void SwapStorage(Container& first, Container& second) noexcept
+		{
+			if (first.get_allocator() == second.get_allocator())
+			{
+				first.swap(second);
+				return;
+			}
+
+			Container temporary(std::move(first));
+			first = std::move(second);
+			second = std::move(temporary);
+		}
+
+		enum class ENumericClass
+		{
+			None,		// contains characters that can't be part of a flat numeric array
+			Integer,	// only digits, separators and whitespace
+			Float		// additionally contains sign, exponent, '.' or 'f' characters
+		};
+
+		// value must not be 0
+		inline unsigned CountTrailingZeros(uint64_t value) noexcept
+		{
+#if defined(_MSC_VER)
+			unsigned long index;
+			if (_BitScanForward(&index, static_cast<unsigned long>(value)))
+				return index;
+			_BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+			return index + 32;
+#else
+			return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+		}
+	}
+
 	class MiniPPFile
 	{
 	public:
+#if MINIPP_ENABLE_VALUE_POOL
+		// Size-class segregated slab pool for Value objects. Every Value carries a small header naming the pool it came
+		// from, so deleting it (SetValue with allowOverwrite, reloads, ...) puts it back on that pool's freelist.
+		// Values are taken from the pool of the innermost active Scope on the current thread, or from the heap.
+		// Not thread-safe, just like the document it belongs to.
+		class ValuePool
+		{
+			friend class MiniPPFile;
+
+		public:
+			class Scope
+			{
+			private:
+				ValuePool* m_previous;
+
+			public:
+				explicit Scope(ValuePool* pool) noexcept;
+				~Scope();
+				Scope(const Scope&) = delete;
+				Scope& operator=(const Scope&) = delete;
+			};
+
+		private:
+			struct FreeNode
+			{
+				FreeNode* next;
+			};
+
+			static constexpr size_t Granularity = 16;
+			static constexpr size_t ClassCount = 32; // objects up to 512 bytes are pooled
+			static constexpr size_t SlabSize = 64 * 1024;
+
+			FreeNode* m_freeLists[ClassCount] = {};
+			Vector<void*> m_slabs;
+#if MINIPP_USE_PMR
+			std::pmr::memory_resource* m_resource;
+#endif
+			char* m_slabCursor = nullptr;
+			char* m_slabEnd = nullptr;
+			size_t m_liveCount = 0;
+			size_t m_recycledCount = 0;
+			bool m_released = false;
+
+		private:
+#if MINIPP_USE_PMR
+			explicit ValuePool(std::pmr::memory_resource* resource) noexcept : m_slabs(resource), m_resource(resource) {}
+#else
+			ValuePool() = default;
+#endif
+			~ValuePool();
+			void* AllocateBlock(size_t size);
+			void FreeBlock(void* block, size_t size) noexcept;
+			void Release() noexcept;
+
+		public:
+			ValuePool(const ValuePool&) = delete;
+			ValuePool& operator=(const ValuePool&) = delete;
+
+			void* Allocate(size_t size);
+			void Deallocate(void* block, size_t size) noexcept;
+
+			size_t GetLiveCount() const noexcept { return m_liveCount; }
+			size_t GetRecycledCount() const noexcept { return m_recycledCount; }
+			size_t GetSlabBytes() const noexcept { return m_slabs.size() * SlabSize; }
+
+			static ValuePool* GetCurrent() noexcept;
+		};
+#endif
+
+#if MINIPP_USE_PMR
+		// Routes every document allocation made on the current thread (Values, Sections and their strings, maps and
+		// vectors) to resource while it is alive. Parse installs the file's resource on its own, this is for trees
+		// that are built or edited by hand.
+		class ResourceScope
+		{
+		private:
+			std::pmr::memory_resource* m_previous;
+
+		public:
+			explicit ResourceScope(std::pmr::memory_resource* resource) noexcept;
+			~ResourceScope();
+			ResourceScope(const ResourceScope&) = delete;
+			ResourceScope& operator=(const ResourceScope&) = delete;
+		};
+#endif
+
 		class Value
 		{
 			friend class MiniPPFile;
 
 		protected:
-			std::vector<std::string> m_comments;
+			Vector<String> m_comments MINIPP_DOCUMENT_ALLOCATOR_INIT;
 
 		public:
-			virtual EResult Parse(const std::string& str) noexcept = 0;
-			virtual EResult ToString(std::string& destination) const noexcept = 0;
+#if MINIPP_ENABLE_VALUE_POOL || MINIPP_USE_PMR
+			static void* operator new(size_t size);
+			static void operator delete(void* ptr, size_t size) noexcept;
+#endif
+
+			virtual EResult Parse(const String& str) noexcept = 0;
+			virtual EResult ToString(String& destination) const noexcept = 0;
+			virtual EValueType GetType() const noexcept = 0;
+			// exact length of what ToString produces
+			virtual size_t MeasureSerializedSize() const noexcept;
+			// appends the value as JSON (ints as plain numbers whatever their style)
+			virtual EResult AppendJson(String& destination) const noexcept;
+			Value() = default;
+			Value(const Value&) = default;
+			Value(Value&&) noexcept = default;
+			Value& operator=(const Value&) = default;
+			Value& operator=(Value&&) noexcept = default;
 			virtual ~Value() = default;
-			std::vector<std::string>& GetComments() noexcept { return m_comments; }
-			const std::vector<std::string>& GetComments() const noexcept { return m_comments; }
+			Vector<String>& GetComments() noexcept { return m_comments; }
+			const Vector<String>& GetComments() const noexcept { return m_comments; }
 
 		public:
-			static std::unique_ptr<Value> ParseValue(std::string value, EResult* result = nullptr);
+			static std::unique_ptr<Value> ParseValue(String value, EResult* result = nullptr);
 		};
 
 		class Values
@@ -99,22 +345,27 @@ namespace minipp
 			class StringValue : public Value
 			{
 			public:
-				using BaseType = std::string;
+				static constexpr EValueType Type = EValueType::String;
+				using BaseType = String;
 
 			private:
-				BaseType m_value;
+				BaseType m_value MINIPP_DOCUMENT_ALLOCATOR_INIT;
 
 			public:
 				StringValue() = default;
-				StringValue(const BaseType& str) : m_value(str) {};
-				EResult Parse(const std::string& str) noexcept override;
-				EResult ToString(std::string& destination) const noexcept override;
+				StringValue(const BaseType& str) : m_value(str MINIPP_DOCUMENT_ALLOCATOR) {};
+				EResult Parse(const String& str) noexcept override;
+				EResult ToString(String& destination) const noexcept override;
+				EValueType GetType() const noexcept override { return Type; }
+				size_t MeasureSerializedSize() const noexcept override;
+				EResult AppendJson(String& destination) const noexcept override;
 				const BaseType& GetValue() const noexcept { return m_value; }
 			};
 
 			class IntValue : public Value
 			{
 			public:
+				static constexpr EValueType Type = EValueType::Int;
 				using BaseType = int64_t;
 
 			private:
@@ -124,14 +375,18 @@ namespace minipp
 			public:
 				IntValue() = default;
 				IntValue(BaseType value) : m_value(value) {};
-				EResult Parse(const std::string& str) noexcept override;
-				EResult ToString(std::string& destination) const noexcept override;
+				EResult Parse(const String& str) noexcept override;
+				EResult ToString(String& destination) const noexcept override;
+				EValueType GetType() const noexcept override { return Type; }
+				size_t MeasureSerializedSize() const noexcept override;
+				EResult AppendJson(String& destination) const noexcept override;
 				BaseType GetValue() const noexcept { return m_value; }
 			};
 
 			class BooleanValue : public Value
 			{
 			public:
+				static constexpr EValueType Type = EValueType::Boolean;
 				using BaseType = bool;
 
 			private:
@@ -140,14 +395,18 @@ namespace minipp
 			public:
 				BooleanValue() = default;
 				BooleanValue(BaseType value) : m_value(value) {};
-				EResult Parse(const std::string& str) noexcept override;
-				EResult ToString(std::string& destination) const noexcept override;
+				EResult Parse(const String& str) noexcept override;
+				EResult ToString(String& destination) const noexcept override;
+				EValueType GetType() const noexcept override { return Type; }
+				size_t MeasureSerializedSize() const noexcept override;
+				EResult AppendJson(String& destination) const noexcept override;
 				BaseType GetValue() const noexcept { return m_value; }
 			};
 
 			class FloatValue : public Value
 			{
 			public:
+				static constexpr EValueType Type = EValueType::Float;
 				using BaseType = double;
 
 			private:
@@ -156,43 +415,165 @@ namespace minipp
 			public:
 				FloatValue() = default;
 				FloatValue(BaseType value) : m_value(value) {};
-				EResult Parse(const std::string& str) noexcept override;
-				EResult ToString(std::string& destination) const noexcept override;
+				EResult Parse(const String& str) noexcept override;
+				EResult ToString(String& destination) const noexcept override;
+				EValueType GetType() const noexcept override { return Type; }
+				size_t MeasureSerializedSize() const noexcept override;
+				EResult AppendJson(String& destination) const noexcept override;
 				BaseType GetValue() const noexcept { return m_value; }
 			};
 
 			class ArrayValue : public Value
 			{
 			public:
-				using BaseType = std::vector<Value*>;
+				static constexpr EValueType Type = EValueType::Array;
+				using BaseType = Vector<Value*>;
+
+			private:
+				// Flat decimal integer, float and boolean arrays are parsed straight into contiguous storage
+				// (booleans as one bit each). Lazy arrays (see ParseLazy) only keep their source text and element offsets.
+				// Either way the elements are only boxed into m_values once somebody asks for the Value* view.
+				enum class EStorage
+				{
+					Boxed,
+					PackedInt,
+					PackedFloat,
+					PackedBool,
+					Lazy
+				};
+
+				mutable BaseType m_values MINIPP_DOCUMENT_ALLOCATOR_INIT;
+				mutable EStorage m_storage = EStorage::Boxed;
+				mutable Vector<int64_t> m_packedInts MINIPP_DOCUMENT_ALLOCATOR_INIT;
+				mutable Vector<double> m_packedFloats MINIPP_DOCUMENT_ALLOCATOR_INIT;
+				mutable Vector<uint64_t> m_packedBits MINIPP_DOCUMENT_ALLOCATOR_INIT;
+				mutable size_t m_packedBitCount = 0;
+				mutable String m_lazySource MINIPP_DOCUMENT_ALLOCATOR_INIT;
+				mutable Vector<uint32_t> m_lazyOffsets MINIPP_DOCUMENT_ALLOCATOR_INIT; // element i spans [m_lazyOffsets[i], m_lazyOffsets[i + 1] - 1)
+				mutable HashMap<size_t, Value*> m_lazyElements MINIPP_DOCUMENT_ALLOCATOR_INIT;
+				EValueType m_lazyElementType = EValueType::Int;
 
 			private:
-				BaseType m_values;
+				bool TryParsePacked(const String& str) noexcept;
+				bool TryParsePackedBooleans(const char* begin, const char* end) noexcept;
+				void Unpack() const;
+				String GetLazyElementText(size_t index) const;
+				std::unique_ptr<Value> ParseLazyElement(size_t index, EResult* result) const;
+				static EResult ValidateElement(const String& element, EValueType* type) noexcept;
+				const Value* GetLazyElement(size_t index) const noexcept;
+				const Value* GetElement(size_t index, std::unique_ptr<Value>& parsedElement, EResult* result) const;
+
+				void ClearStorage() noexcept;
+
+				template<typename ValueDataType, typename TargetType>
+				EResult CopyBoxedTo(TargetType* destination, size_t count) const noexcept;
+				template<typename TargetType>
+				EResult CopyFlatTo(TargetType* destination, size_t capacity, size_t& written) const noexcept;
 
 			public:
 				ArrayValue() = default;
 				ArrayValue(const ArrayValue&) = delete;
 				ArrayValue& operator=(const ArrayValue&) = delete;
+				ArrayValue(ArrayValue&& other) noexcept;
+				ArrayValue& operator=(ArrayValue&& other) noexcept;
 				virtual ~ArrayValue();
 
+				void Swap(ArrayValue& other) noexcept;
+				friend void swap(ArrayValue& first, ArrayValue& second) noexcept { first.Swap(second); }
+
 			public:
-				EResult Parse(const std::string& str) noexcept override;
-				EResult ToString(std::string& destination) const noexcept override;
-				BaseType& GetValue() noexcept { return m_values; }
-				const BaseType& GetValue() const noexcept { return m_values; }
+				EResult Parse(const String& str) noexcept override;
+				EResult ToString(String& destination) const noexcept override;
+				EValueType GetType() const noexcept override { return Type; }
+				size_t MeasureSerializedSize() const noexcept override;
+				EResult AppendJson(String& destination) const noexcept override;
+				// The Value* view boxes packed and lazy arrays on first use (may throw std::bad_alloc, the array is left as
+				// it was then). Even the const overloads (and operator[]) write the array's internal storage on first use,
+				// so concurrent readers need an array that was unpacked before it was shared (see VersionedConfig).
+				BaseType& GetValue()
+				{
+					if (m_storage != EStorage::Boxed)
+						Unpack();
+					return m_values;
+				}
+				const BaseType& GetValue() const
+				{
+					if (m_storage != EStorage::Boxed)
+						Unpack();
+					return m_values;
+				}
 
-				Value* operator[](size_t index) noexcept
+				// Indexes the top-level elements of the array literal and checks them like Parse does (same errors), but
+				// only boxes an element into a Value when it is first accessed through operator[].
+				EResult ParseLazy(String str) noexcept;
+
+				size_t GetSize() const noexcept;
+				bool IsPacked() const noexcept { return m_storage != EStorage::Boxed && m_storage != EStorage::Lazy; }
+				bool IsLazy() const noexcept { return m_storage == EStorage::Lazy; }
+				EResult GetElementType(EValueType* destination) const noexcept;
+
+				// Bulk extraction of the first count elements into a caller buffer. The element type is checked once
+				// (InvalidDataType if it doesn't match the target), packed arrays are copied without touching any Value.
+				EResult CopyTo(int64_t* destination, size_t count) const noexcept;
+				EResult CopyTo(double* destination, size_t count) const noexcept;
+				EResult CopyTo(float* destination, size_t count) const noexcept;
+				EResult CopyTo(bool* destination, size_t count) const noexcept;
+				EResult CopyTo(String* destination, size_t count) const noexcept;
+
+				// Flattens nested arrays (e.g. [[0, 0], [1, 0]]) in element order. GetFlatSize() tells the required capacity.
+				size_t GetFlatSize() const noexcept;
+				EResult CopyFlatTo(int64_t* destination, size_t capacity, size_t* written = nullptr) const noexcept;
+				EResult CopyFlatTo(double* destination, size_t capacity, size_t* written = nullptr) const noexcept;
+				EResult CopyFlatTo(float* destination, size_t capacity, size_t* written = nullptr) const noexcept;
+				EResult CopyFlatTo(bool* destination, size_t capacity, size_t* written = nullptr) const noexcept;
+				EResult CopyFlatTo(String* destination, size_t capacity, size_t* written = nullptr) const noexcept;
+
+				// Bit-level access to boolean arrays. Element i is bit (i % 64) of word (i / 64), unused bits
+				// of the last word are zero. The words are only available while IsBitPacked() is true,
+				// the other accessors fall back to the boxed BooleanValue elements otherwise.
+				bool IsBitPacked() const noexcept { return m_storage == EStorage::PackedBool; }
+				const Vector<uint64_t>& GetBitWords() const noexcept { return m_packedBits; }
+				void AssignBits(const uint64_t* words, size_t bitCount);
+				bool TestBit(size_t index) const noexcept;
+				size_t CountSetBits() const noexcept;
+
+				template<typename Callback>
+				void ForEachSetBit(Callback callback) const
 				{
-					if (index >= m_values.size())
-						return nullptr;
-					return m_values[index];
+					if (m_storage == EStorage::PackedBool)
+					{
+						for (size_t wordIndex = 0; wordIndex < m_packedBits.size(); ++wordIndex)
+						{
+							uint64_t word = m_packedBits[wordIndex];
+							while (word != 0)
+							{
+								callback(wordIndex * 64 + detail::CountTrailingZeros(word));
+								word &= word - 1;
+							}
+						}
+						return;
+					}
+
+					for (size_t i = 0; i < GetSize(); ++i)
+						if (TestBit(i))
+							callback(i);
+				}
+
+				// nullptr if index is out of range (or a lazy element can't be parsed). Not safe for concurrent readers, see GetValue.
+				Value* operator[](size_t index)
+				{
+					return const_cast<Value*>(static_cast<const ArrayValue&>(*this)[index]);
 				}
 
-				const Value* operator[](size_t index) const noexcept
+				const Value* operator[](size_t index) const
 				{
-					if (index >= m_values.size())
+					if (m_storage == EStorage::Lazy)
+						return GetLazyElement(index);
+
+					auto& values = GetValue();
+					if (index >= values.size())
 						return nullptr;
-					return m_values[index];
+					return values[index];
 				}
 			};
 		};
@@ -202,35 +583,46 @@ namespace minipp
 			friend class MiniPPFile;
 
 		private:
-			std::unordered_map<std::string, Value*> m_values;
-			std::unordered_map<std::string, Section*> m_subSections;
-			std::vector<std::string> m_comments;
+			HashMap<String, Value*> m_values MINIPP_DOCUMENT_ALLOCATOR_INIT;
+			HashMap<String, Section*> m_subSections MINIPP_DOCUMENT_ALLOCATOR_INIT;
+			Vector<String> m_comments MINIPP_DOCUMENT_ALLOCATOR_INIT;
 
 		public:
-			std::vector<std::string>& GetComments() noexcept { return m_comments; }
-			const std::vector<std::string>& GetComments() const noexcept { return m_comments; }
-			std::unordered_map<std::string, Value*>& GetValues() noexcept { return m_values; }
-			const std::unordered_map<std::string, Value*>& GetValues() const noexcept { return m_values; }
-			std::unordered_map<std::string, Section*>& GetSubSections() noexcept { return m_subSections; }
-			const std::unordered_map<std::string, Section*>& GetSubSections() const noexcept { return m_subSections; }
+			Vector<String>& GetComments() noexcept { return m_comments; }
+			const Vector<String>& GetComments() const noexcept { return m_comments; }
+			HashMap<String, Value*>& GetValues() noexcept { return m_values; }
+			const HashMap<String, Value*>& GetValues() const noexcept { return m_values; }
+			HashMap<String, Section*>& GetSubSections() noexcept { return m_subSections; }
+			const HashMap<String, Section*>& GetSubSections() const noexcept { return m_subSections; }
 
 		public:
 			Section() = default;
+#if MINIPP_USE_PMR
+			explicit Section(std::pmr::memory_resource* resource) noexcept
+				: m_values(resource), m_subSections(resource), m_comments(resource) {}
+			static void* operator new(size_t size);
+			static void operator delete(void* ptr, size_t size) noexcept;
+#endif
 			~Section();
 			Section(const Section&) = delete;
 			Section& operator=(const Section&) = delete;
+			Section(Section&& other) noexcept;
+			Section& operator=(Section&& other) noexcept;
+
+			void Swap(Section& other) noexcept;
+			friend void swap(Section& first, Section& second) noexcept { first.Swap(second); }
 
 		public:
 			template<typename ValueDataType>
-			EResult GetValue(const std::string& key, ValueDataType** target) noexcept
+			EResult GetValue(const String& key, ValueDataType** target) noexcept
 			{
 				static_assert(std::is_base_of<Value, ValueDataType>::value, "ValueDataType must be a subclass of Value");
 
 				int64_t firstSeparatorIndex = Tools::FirstIndexOf(key, '.');
 				if (firstSeparatorIndex != -1)
 				{
-					std::string thisKey = key.substr(0, firstSeparatorIndex);
-					std::string rest = key.substr(firstSeparatorIndex + 1);
+					String thisKey = key.substr(0, firstSeparatorIndex);
+					String rest = key.substr(firstSeparatorIndex + 1);
 
 					auto it = m_subSections.find(thisKey);
 					if (it == m_subSections.end())
@@ -252,26 +644,54 @@ namespace minipp
 			}
 
 			template<typename ValueDataType>
-			EResult SetValue(const std::string& name, std::unique_ptr<ValueDataType> value, bool allowOverwrite = false) noexcept
+			EResult SetValue(String name, std::unique_ptr<ValueDataType> value, bool allowOverwrite = false) noexcept
 			{
 				static_assert(std::is_base_of<Value, ValueDataType>::value, "ValueDataType must be a subclass of Value");
-				bool overwritten = false;
 
-				if (m_values.find(name) != m_values.end())
+				auto inserted = m_values.emplace(std::move(name), value.get());
+				if (!inserted.second)
+				{
 					if (!allowOverwrite)
 						return EResult::KeyAlreadyPresent;
-					else
-					{
-						delete m_values[name];
-						overwritten = true;
-					}
+					delete inserted.first->second;
+					inserted.first->second = value.release();
+					return EResult::ValueOverwritten;
+				}
+
+				value.release();
+				return EResult::Success;
+			}
+
+			// Like try_emplace: name is hashed once and the value is only constructed (from args) if name isn't taken yet.
+			// Returns KeyAlreadyPresent otherwise. destination (optional) receives the new value.
+			// If construction throws, the name is removed again and the exception propagates.
+			template<typename ValueDataType, typename... Args>
+			EResult EmplaceValue(String name, ValueDataType** destination, Args&&... args)
+			{
+				static_assert(std::is_base_of<Value, ValueDataType>::value, "ValueDataType must be a subclass of Value");
 
-				m_values[name] = value.release();
-				return overwritten ? EResult::ValueOverwritten : EResult::Success;
+				auto inserted = m_values.emplace(std::move(name), nullptr);
+				if (!inserted.second)
+					return EResult::KeyAlreadyPresent;
+
+				ValueDataType* value = nullptr;
+				try
+				{
+					value = new ValueDataType(std::forward<Args>(args)...);
+				}
+				catch (...)
+				{
+					m_values.erase(inserted.first);
+					throw;
+				}
+				inserted.first->second = value;
+				if (destination != nullptr)
+					*destination = value;
+				return EResult::Success;
 			}
 
 			template<typename ValueDataType>
-			typename ValueDataType::BaseType GetValueOrDefault(const std::string& key, 
+			typename ValueDataType::BaseType GetValueOrDefault(const String& key, 
 				const typename ValueDataType::BaseType& defaultValue = typename ValueDataType::BaseType{})
 			{
 				static_assert(std::is_base_of<Value, ValueDataType>::value, "ValueDataType must be a subclass of Value");
@@ -286,749 +706,6707 @@ namespace minipp
 			}
 
 		public:
-			EResult GetSubSection(const std::string& key, Section** destination) const noexcept;
-			EResult SetSubSection(const std::string& name, std::unique_ptr<Section> value, bool allowOverwrite = false) noexcept;
+			EResult GetSubSection(const String& key, Section** destination) const noexcept;
+			EResult SetSubSection(String name, std::unique_ptr<Section> value, bool allowOverwrite = false) noexcept;
+			// Creates an empty sub-section unless name is taken (SectionAlreadyPresent). Either way
+			// destination (optional) receives the sub-section called name. Throws std::bad_alloc
+			// if the new section can't be allocated, leaving the section unchanged.
+			EResult EmplaceSubSection(String name, Section** destination);
+			void Reserve(size_t valueCount, size_t subSectionCount = 0);
+			void Clear() noexcept;
 		};
 
-	public:
-		MiniPPFile() = default;
+		class OutputSink
+		{
+		public:
+			virtual ~OutputSink() = default;
+			virtual EResult Write(const char* data, size_t size) noexcept = 0;
+			virtual EResult Flush() noexcept { return EResult::Success; }
+		};
 
-	private:
-		Section m_rootSection{};
+		class StreamSink : public OutputSink
+		{
+		private:
+			std::ostream& m_stream;
 
-	private:
-		static minipp::EResult WriteSection(const Section* section, std::ofstream& ofs, std::string partTreeName) noexcept;
+		public:
+			explicit StreamSink(std::ostream& stream) noexcept : m_stream(stream) {}
+			EResult Write(const char* data, size_t size) noexcept override;
+			EResult Flush() noexcept override;
+		};
 
-	public:
-		EResult Parse(const std::string& path, bool additional = false) noexcept;
-		EResult Parse(std::ifstream& ifs, bool additional = false) noexcept;
-		EResult Write(const std::string& path) const noexcept;
-		EResult Write(std::ofstream& ofs) const noexcept;
+		// Appends everything to a string, e.g. to render a document in memory
+		class StringSink : public OutputSink
+		{
+		private:
+			String& m_destination;
 
-	public:
-		const Section& GetRoot() const noexcept { return m_rootSection; }
-		Section& GetRoot() noexcept { return m_rootSection; }
+		public:
+			explicit StringSink(String& destination) noexcept : m_destination(destination) {}
+			EResult Write(const char* data, size_t size) noexcept override;
+		};
 
-	public:
-		static bool IsResultOk(EResult result) noexcept;
+		// Streaming decompression, one object per compressed stream.
+		class Decoder
+		{
+		public:
+			virtual ~Decoder() = default;
+			// Decodes as much of input into output as fits. consumed and produced receive the byte counts,
+			// finished becomes true at the end of the compressed stream. FormatError for corrupt input.
+			virtual EResult Decode(const char* input, size_t inputSize, size_t* consumed,
+				char* output, size_t outputSize, size_t* produced, bool* finished) noexcept = 0;
+		};
 
-	private:
-		class Tools
+		// Streaming compression, one object per compressed stream.
+		class Encoder
 		{
 		public:
-			static bool StringStartsWith(const std::string& str, const std::string& beg);
-			static bool StringEndsWith(const std::string& str, const std::string& end);
-			static void StringTrim(std::string& str);
-			static bool IsNameValid(const std::string& name) noexcept;
-			static int64_t FirstIndexOf(const std::string& str, char c) noexcept;
-			static int64_t LastIndexOf(const std::string& str, char c) noexcept;
-			static std::pair<std::string, std::string> SplitInTwo(const std::string& str, int64_t firstLength) noexcept;
-			static std::vector<std::string> SplitByDelimiter(const std::string& str, char delimiter) noexcept;
-			static void RemoveAll(std::string& str, char old);
-			static bool IsIntegerDecimal(const std::string& str) noexcept;
+			virtual ~Encoder() = default;
+			// May keep data back until Finish, which ends the stream.
+			virtual EResult Encode(const char* data, size_t size, OutputSink& sink) noexcept = 0;
+			virtual EResult Finish(OutputSink& sink) noexcept = 0;
 		};
-	};
-}
 
-#ifdef MINIPP_IMPLEMENTATION
+		// Chosen by the extension of the path in Parse(path), Write(path) and WriteMapped. Built in are ".gz"
+		// (MINIPP_WITH_ZLIB) and ".zst" (MINIPP_WITH_ZSTD), without them these files fail with FileIOError.
+		// See RegisterCodec for others.
+		struct Codec
+		{
+			String extension;
+			std::unique_ptr<Decoder>(*createDecoder)() = nullptr;
+			std::unique_ptr<Encoder>(*createEncoder)() = nullptr;
+		};
 
-#include <fstream>
-#include <typeinfo>
-#include <sstream>
-#include <bitset>
+		// Decompresses source on the fly, so Parse(std::istream&) never sees more than one buffer of it.
+		// After parsing, GetResult tells decoding errors (and truncated input) apart from a plain end of file.
+		class DecodingStreamBuffer : public std::streambuf
+		{
+		private:
+			std::istream& m_source;
+			std::unique_ptr<Decoder> m_decoder;
+			Vector<char> m_input;
+			Vector<char> m_output;
+			size_t m_inputBegin = 0;
+			size_t m_inputEnd = 0;
+			bool m_finished = false;
+			EResult m_result = EResult::Success;
 
-#if MINIPP_ENABLE_DEBUG_OUTPUT
-#include <iostream>
-	#define PP_COUT(msg) std::cout << "[minipp] " << msg << std::endl
-#else
-	#define PP_COUT(msg)
-#endif
+		protected:
+			int_type underflow() override;
 
-#define PP_COUT_SYNTAX_ERROR_LINE(line, msg) PP_COUT(line << ": " << msg)
-#define PP_COUT_SYNTAX_ERROR(msg) PP_COUT("Syntax error: " << msg)
+		public:
+			DecodingStreamBuffer(std::istream& source, std::unique_ptr<Decoder> decoder, size_t bufferSize = 64 * 1024);
+			EResult GetResult() const noexcept { return m_result; }
+		};
 
-std::unique_ptr<minipp::MiniPPFile::Value> minipp::MiniPPFile::Value::ParseValue(std::string value, EResult* result)
-{
-#define RETURN_NULLPTR_WITH_RESULT(r) { if (result != nullptr) *result = r; return nullptr; }
+		// Compresses everything written to it into sink. Flush only flushes sink, Finish ends the compressed stream.
+		class EncodingSink : public OutputSink
+		{
+		private:
+			OutputSink& m_sink;
+			std::unique_ptr<Encoder> m_encoder;
 
-	char valueFirstChar = value.front();
-	char valueLastChar = value.back();
-	if (valueFirstChar == '"')
-	{
-		if (valueLastChar != '"')
-			RETURN_NULLPTR_WITH_RESULT(EResult::MissingQuote);
+		public:
+			EncodingSink(OutputSink& sink, std::unique_ptr<Encoder> encoder) noexcept : m_sink(sink), m_encoder(std::move(encoder)) {}
+			EResult Write(const char* data, size_t size) noexcept override { return m_encoder->Encode(data, size, m_sink); }
+			EResult Flush() noexcept override { return m_sink.Flush(); }
+			EResult Finish() noexcept { return m_encoder->Finish(m_sink); }
+		};
 
-		// is string
-		value = value.substr(1, value.size() - 2);
-		auto strValue = std::make_unique<Values::StringValue>();
-		auto parseResult = strValue->Parse(value);
-		if (!IsResultOk(parseResult))
-			RETURN_NULLPTR_WITH_RESULT(parseResult);
+		// Emits mini text straight to a sink, without building a Section tree first. Output is formatted
+		// exactly like Write (same escaping and int styles), but duplicate keys / sections are not detected.
+		// Errors from the sink are sticky, every later call returns them too.
+		class MiniWriter
+		{
+		private:
+			struct ArrayLevel
+			{
+				size_t count = 0;
+				EValueType elementType = EValueType::Int;
+			};
 
-		return strValue;
-	}
-	else if (valueLastChar == 'e')
-	{
-		auto boolValue = std::make_unique<Values::BooleanValue>();
-		auto parseResult = boolValue->Parse(value);
-		if (!IsResultOk(parseResult))
-			RETURN_NULLPTR_WITH_RESULT(parseResult);
+			OutputSink& m_sink;
+			String m_buffer;
+			size_t m_bufferSize;
+			Vector<ArrayLevel> m_arrays;
+			EResult m_error = EResult::Success;
+			bool m_inSection = false;
+			bool m_sectionHasValues = false;
+			size_t m_commentStart = String::npos; // comments directly in front of the next section header
 
-		return boolValue;
-	}
-	else if (valueLastChar == 'f')
-	{
-		auto floatValue = std::make_unique<Values::FloatValue>();
-		auto parseResult = floatValue->Parse(value);
-		if (!IsResultOk(parseResult))
-			RETURN_NULLPTR_WITH_RESULT(parseResult);
+		private:
+			EResult BeginValue(const String* name, EValueType type) noexcept;
+			EResult EndValue() noexcept;
+			EResult FlushIfFull() noexcept;
+			EResult WriteInt(const String* name, int64_t value, EIntStyle style) noexcept;
+			EResult WriteFloat(const String* name, double value) noexcept;
+			EResult WriteBoolean(const String* name, bool value) noexcept;
+			EResult WriteString(const String* name, const char* value, size_t size) noexcept;
+
+			template<typename T>
+			using EnableIfOtherInteger = typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, int64_t>::value>::type;
+			template<typename T>
+			using EnableIfOtherFloat = typename std::enable_if<std::is_floating_point<T>::value && !std::is_same<T, double>::value>::type;
 
-		return floatValue;
-	}
-	else if (valueLastChar == ']')
-	{
-		auto arrayValue = std::make_unique<Values::ArrayValue>();
-		auto parseResult = arrayValue->Parse(value);
-		if (!IsResultOk(parseResult))
-			RETURN_NULLPTR_WITH_RESULT(parseResult);
+		public:
+			explicit MiniWriter(OutputSink& sink, size_t bufferSize = 64 * 1024);
+			~MiniWriter();
+			MiniWriter(const MiniWriter&) = delete;
+			MiniWriter& operator=(const MiniWriter&) = delete;
+
+			EResult BeginSection(const String& path) noexcept;
+			// every line of text becomes a "# " comment line
+			EResult Comment(const String& text) noexcept;
+
+			EResult Key(const String& name, int64_t value, EIntStyle style = EIntStyle::Decimal) noexcept { return WriteInt(&name, value, style); }
+			EResult Key(const String& name, double value) noexcept { return WriteFloat(&name, value); }
+			EResult Key(const String& name, bool value) noexcept { return WriteBoolean(&name, value); }
+			EResult Key(const String& name, const char* value) noexcept { return WriteString(&name, value, std::char_traits<char>::length(value)); }
+			EResult Key(const String& name, const char* value, size_t size) noexcept { return WriteString(&name, value, size); }
+			EResult Key(const String& name, const String& value) noexcept { return WriteString(&name, value.data(), value.size()); }
+#if MINIPP_HAS_CPP17
+			EResult Key(const String& name, std::string_view value) noexcept { return WriteString(&name, value.data(), value.size()); }
+#endif
+			template<typename T, typename = EnableIfOtherInteger<T>>
+			EResult Key(const String& name, T value, EIntStyle style = EIntStyle::Decimal) noexcept { return WriteInt(&name, static_cast<int64_t>(value), style); }
+			template<typename T, typename = EnableIfOtherFloat<T>, typename = void>
+			EResult Key(const String& name, T value) noexcept { return WriteFloat(&name, static_cast<double>(value)); }
+
+			// BeginArray(name) starts a key, BeginArray() a nested array inside the open one.
+			// All elements of an array must have the same type (ArrayDataTypeInconsistency otherwise).
+			EResult BeginArray(const String& name) noexcept;
+			EResult BeginArray() noexcept;
+			EResult EndArray() noexcept;
+
+			EResult Element(int64_t value, EIntStyle style = EIntStyle::Decimal) noexcept { return WriteInt(nullptr, value, style); }
+			EResult Element(double value) noexcept { return WriteFloat(nullptr, value); }
+			EResult Element(bool value) noexcept { return WriteBoolean(nullptr, value); }
+			EResult Element(const char* value) noexcept { return WriteString(nullptr, value, std::char_traits<char>::length(value)); }
+			EResult Element(const char* value, size_t size) noexcept { return WriteString(nullptr, value, size); }
+			EResult Element(const String& value) noexcept { return WriteString(nullptr, value.data(), value.size()); }
+#if MINIPP_HAS_CPP17
+			EResult Element(std::string_view value) noexcept { return WriteString(nullptr, value.data(), value.size()); }
+#endif
+			template<typename T, typename = EnableIfOtherInteger<T>>
+			EResult Element(T value, EIntStyle style = EIntStyle::Decimal) noexcept { return WriteInt(nullptr, static_cast<int64_t>(value), style); }
+			template<typename T, typename = EnableIfOtherFloat<T>, typename = void>
+			EResult Element(T value) noexcept { return WriteFloat(nullptr, static_cast<double>(value)); }
+
+			// Splices in already formatted mini text made of complete sections (e.g. from another MiniWriter).
+			// Keys written afterwards belong to the last of those sections.
+			EResult AppendSections(const char* text, size_t size) noexcept;
+
+			// hands the buffered text to the sink; Finish additionally checks that all arrays were closed
+			EResult Flush() noexcept;
+			EResult Finish() noexcept;
+			EResult GetError() const noexcept { return m_error; }
+		};
 
-		return arrayValue;
-	}
-	else
-	{
-		auto intValue = std::make_unique<Values::IntValue>();
-		auto parseResult = intValue->Parse(value);
-		if (!IsResultOk(parseResult))
-			RETURN_NULLPTR_WITH_RESULT(parseResult);
+		// Epoch-based reclamation: objects that were unlinked while lock-free readers may still be looking at them
+		// are retired here and only deleted once every reader that pinned the domain before the unlink is done.
+		class EpochDomain
+		{
+		private:
+			struct ReaderSlot
+			{
+				std::atomic<uint64_t> epoch{ 0 }; // 0: free, otherwise the epoch the reader started in
+				char padding[64 - sizeof(std::atomic<uint64_t>)];
+			};
 
-		return intValue;
-	}
-}
+			struct RetiredObject
+			{
+				uint64_t epoch;
+				void* object;
+				void (*deleter)(void*);
+			};
 
-#pragma region Value Types
+			static constexpr size_t ReclaimThreshold = 128; // Retire reclaims on its own once this many objects wait
 
-minipp::EResult minipp::MiniPPFile::Values::StringValue::Parse(const std::string& str) noexcept
-{
-	m_value = "";
+			std::unique_ptr<ReaderSlot[]> m_readerSlots;
+			size_t m_readerSlotCount;
+			std::atomic<uint64_t> m_epoch{ 1 };
 
-	for (size_t i = 0; i < str.size(); ++i)
-	{
-		if (str[i] == '\\')
-		{
-			if (i + 1 >= str.size())
-			{
-				PP_COUT_SYNTAX_ERROR("'\\' at end of string");
-				return EResult::BadEscapeSequence;
-			}
+			std::mutex m_retiredMutex;
+			Vector<RetiredObject> m_retired; // ordered by epoch
 
-			switch (str[i + 1])
+		private:
+			void Retire(void* object, void (*deleter)(void*));
+
+		public:
+			class Guard
 			{
-			case '\"':
-				m_value.push_back('\"');
-				break;
-			case 'n':
-				m_value.push_back('\n');
-				break;
-			case 't':
-				m_value.push_back('\t');
-				break;
-			case 'r':
-				m_value.push_back('\r');
-				break;
-			case '\\':
-				m_value.push_back('\\');
-				break;
-			default:
-				PP_COUT_SYNTAX_ERROR("Unknown escape sequence '\\" << str[i + 1] << "'");
-				return EResult::UnknownEscapeSequence;
+				friend class EpochDomain;
+
+			private:
+				std::atomic<uint64_t>* m_slot;
+
+				explicit Guard(std::atomic<uint64_t>* slot) noexcept : m_slot(slot) {}
+
+			public:
+				Guard(Guard&& other) noexcept : m_slot(other.m_slot) { other.m_slot = nullptr; }
+				Guard(const Guard&) = delete;
+				Guard& operator=(const Guard&) = delete;
+				Guard& operator=(Guard&&) = delete;
+				~Guard();
+			};
+
+		public:
+			// readerSlots bounds the number of guards that can be held at the same time, Pin() waits for a free one
+			explicit EpochDomain(size_t readerSlots = 64);
+			// deletes everything still retired, no Guard may be alive anymore
+			~EpochDomain();
+			EpochDomain(const EpochDomain&) = delete;
+			EpochDomain& operator=(const EpochDomain&) = delete;
+
+			// Pointers loaded (seq_cst) from shared atomics after Pin() stay valid until the guard is destroyed
+			Guard Pin() const noexcept;
+
+			// object must already be unreachable for new readers (replaced with a seq_cst store)
+			template<typename T>
+			void Retire(const T* object)
+			{
+				Retire(const_cast<void*>(static_cast<const void*>(object)), [](void* pointer) { delete static_cast<T*>(pointer); });
+			}
+
+			// Deletes the retired objects no reader can see anymore, returns how many
+			size_t Reclaim() noexcept;
+			size_t GetRetiredCount() noexcept;
+		};
+
+		// Publishes immutable versions of a config tree. An update copies only the sections on the path to the
+		// change, all other sub-sections and values are shared with the previous version. Readers pin the current
+		// version with Read() without taking a lock. A replaced version is freed (by a later update or Reclaim)
+		// once every reader that could still see it has finished (epoch-based reclamation).
+		// Updates are serialized by an internal mutex. Values keep their ValuePool alive; with MINIPP_USE_PMR
+		// the resource of published trees has to outlive the config.
+		class VersionedConfig
+		{
+		public:
+			// one section of a published version, never changes once published
+			class Node
+			{
+				friend class VersionedConfig;
+
+			private:
+				HashMap<String, std::shared_ptr<const Value>> m_values;
+				HashMap<String, std::shared_ptr<const Node>> m_subSections;
+				Vector<String> m_comments;
+
+			public:
+				const HashMap<String, std::shared_ptr<const Value>>& GetValues() const noexcept { return m_values; }
+				const HashMap<String, std::shared_ptr<const Node>>& GetSubSections() const noexcept { return m_subSections; }
+				const Vector<String>& GetComments() const noexcept { return m_comments; }
+
+				// key and path may contain '.' like with Section
+				EResult GetSubSection(const String& path, const Node** destination) const noexcept;
+
+				template<typename ValueDataType>
+				EResult GetValue(const String& key, const ValueDataType** target) const noexcept
+				{
+					static_assert(std::is_base_of<Value, ValueDataType>::value, "ValueDataType must be a subclass of Value");
+
+					const Node* node = this;
+					size_t begin = 0;
+					size_t separator;
+					while ((separator = key.find('.', begin)) != String::npos)
+					{
+						auto it = node->m_subSections.find(key.substr(begin, separator - begin));
+						if (it == node->m_subSections.end())
+							return EResult::SectionNotPresent;
+						node = it->second.get();
+						begin = separator + 1;
+					}
+
+					auto it = node->m_values.find(begin == 0 ? key : key.substr(begin));
+					if (it == node->m_values.end())
+						return EResult::KeyNotPresent;
+
+					auto value = dynamic_cast<const ValueDataType*>(it->second.get());
+					if (value == nullptr)
+						return EResult::InvalidDataType;
+
+					*target = value;
+					return EResult::Success;
+				}
+
+				template<typename ValueDataType>
+				typename ValueDataType::BaseType GetValueOrDefault(const String& key,
+					const typename ValueDataType::BaseType& defaultValue = typename ValueDataType::BaseType{}) const
+				{
+					const ValueDataType* value = nullptr;
+					if (GetValue(key, &value) != EResult::Success)
+						return defaultValue;
+					return value->GetValue();
+				}
+			};
+
+		private:
+			struct Version
+			{
+				uint64_t number;
+				std::shared_ptr<const Node> root;
+			};
+
+			mutable EpochDomain m_epochs;
+			std::atomic<const Version*> m_current{ nullptr };
+			std::mutex m_writerMutex;
+
+		private:
+			EResult Install(std::shared_ptr<const Node> root, uint64_t* version) noexcept;
+			static std::shared_ptr<const Node> Adopt(Section& section);
+			template<typename Edit>
+			static std::shared_ptr<const Node> CopyPath(const Node* node, const Vector<String>& path, size_t index, Edit& edit);
+
+		public:
+			// Pins the version that was current when Read() was called, until the guard is destroyed.
+			// Keep guards short-lived: a pinned version and everything retired after it stay allocated.
+			class ReadGuard
+			{
+				friend class VersionedConfig;
+
+			private:
+				EpochDomain::Guard m_guard;
+				const Version* m_version;
+
+				ReadGuard(EpochDomain::Guard&& guard, const Version* version) noexcept : m_guard(std::move(guard)), m_version(version) {}
+
+			public:
+				ReadGuard(ReadGuard&& other) noexcept = default;
+
+				const Node& GetRoot() const noexcept { return *m_version->root; }
+				uint64_t GetVersion() const noexcept { return m_version->number; }
+			};
+
+		public:
+			// readerSlots bounds the number of guards that can be held at the same time, Read() waits for a free one
+			explicit VersionedConfig(size_t readerSlots = 64);
+			// no ReadGuard may be alive anymore
+			~VersionedConfig();
+			VersionedConfig(const VersionedConfig&) = delete;
+			VersionedConfig& operator=(const VersionedConfig&) = delete;
+
+			ReadGuard Read() const noexcept;
+
+			// Replaces the whole tree with the contents of root (which is left empty). Version 0 is the empty tree.
+			EResult Publish(Section&& root, uint64_t* version = nullptr) noexcept;
+			// Replaces or adds the sub-section at path (e.g. "game.window"), missing parent sections are created.
+			EResult PublishSection(const String& path, Section&& section, uint64_t* version = nullptr) noexcept;
+			// Replaces or adds the value at path (e.g. "game.window.width"), missing sections are created.
+			EResult PublishValue(const String& path, std::unique_ptr<Value> value, uint64_t* version = nullptr) noexcept;
+
+			// Frees the replaced versions no reader can see anymore, returns how many. Updates do this on their own.
+			size_t Reclaim() noexcept;
+			size_t GetRetiredCount() noexcept;
+		};
+
+		// Opt-in thread-safe counterpart of Section for trees that are edited while being read. Every section
+		// splits its values into shards, each an immutable hash map that writers copy, change and swap in under
+		// the shard's mutex (sub-sections live in one more such map). Readers never block: they pin the tree with
+		// Read() and look values up without locking, writers to different sections or shards run in parallel.
+		// Replaced maps, values and removed sub-sections are freed through the root's EpochDomain, by whichever
+		// writer happens to reclaim, so pooled values (ValuePool isn't thread-safe) must not be put in here.
+		// Writes copy one shard, so they cost O(values / shardCount): meant for configs that are read far more often.
+		class ConcurrentSection
+		{
+		public:
+			using ReadGuard = EpochDomain::Guard;
+
+		private:
+			using ValueMap = HashMap<String, const Value*>;
+			using SubSectionMap = HashMap<String, ConcurrentSection*>;
+
+			struct Shard
+			{
+				std::mutex writerMutex;
+				std::atomic<const ValueMap*> values;
+			};
+
+			std::unique_ptr<EpochDomain> m_ownedEpochs; // root only
+			EpochDomain* m_epochs;
+			std::unique_ptr<Shard[]> m_shards;
+			size_t m_shardCount;
+			std::mutex m_subSectionMutex;
+			std::atomic<const SubSectionMap*> m_subSections;
+
+		private:
+			ConcurrentSection(EpochDomain* epochs, size_t shardCount);
+			Shard& GetShard(const String& name) const noexcept;
+			const Value* FindValue(const String& key) const noexcept;
+			const ConcurrentSection* FindSubSection(const String& name) const noexcept;
+			EResult CopyPinned(Section& destination) const noexcept;
+
+		public:
+			// readerSlots: see EpochDomain, shared by all sub-sections
+			explicit ConcurrentSection(size_t shardCount = 16, size_t readerSlots = 64);
+			// no ReadGuard may be alive anymore
+			~ConcurrentSection();
+			ConcurrentSection(const ConcurrentSection&) = delete;
+			ConcurrentSection& operator=(const ConcurrentSection&) = delete;
+
+			// Pins the whole tree: values and sections found while the guard lives stay valid
+			ReadGuard Read() const noexcept { return m_epochs->Pin(); }
+
+			// key and path may contain '.' like with Section
+			EResult GetSubSection(const ReadGuard& guard, const String& path, const ConcurrentSection** destination) const noexcept;
+
+			template<typename ValueDataType>
+			EResult GetValue(const ReadGuard& guard, const String& key, const ValueDataType** target) const noexcept
+			{
+				static_assert(std::is_base_of<Value, ValueDataType>::value, "ValueDataType must be a subclass of Value");
+
+				const ConcurrentSection* section = this;
+				size_t separator = key.rfind('.');
+				if (separator != String::npos)
+				{
+					auto result = GetSubSection(guard, key.substr(0, separator), &section);
+					if (!IsResultOk(result))
+						return result;
+				}
+
+				const Value* value = section->FindValue(separator == String::npos ? key : key.substr(separator + 1));
+				if (value == nullptr)
+					return EResult::KeyNotPresent;
+
+				auto casted = dynamic_cast<const ValueDataType*>(value);
+				if (casted == nullptr)
+					return EResult::InvalidDataType;
+
+				*target = casted;
+				return EResult::Success;
+			}
+
+			template<typename ValueDataType>
+			typename ValueDataType::BaseType GetValueOrDefault(const ReadGuard& guard, const String& key,
+				const typename ValueDataType::BaseType& defaultValue = typename ValueDataType::BaseType{}) const
+			{
+				const ValueDataType* value = nullptr;
+				if (GetValue(guard, key, &value) != EResult::Success)
+					return defaultValue;
+				return value->GetValue();
+			}
+
+			// Same results as with Section (KeyAlreadyPresent, ValueOverwritten). name must not contain '.'
+			EResult SetValue(const String& name, std::unique_ptr<Value> value, bool allowOverwrite = false) noexcept;
+			EResult RemoveValue(const String& name) noexcept;
+			// Creates an empty sub-section unless name is taken (SectionAlreadyPresent). Either way destination
+			// (optional) receives the sub-section called name, it stays valid until it is removed.
+			EResult EmplaceSubSection(const String& name, ConcurrentSection** destination) noexcept;
+			EResult RemoveSubSection(const String& name) noexcept;
+
+			// Moves the values and sub-sections of section in (overwriting values), section is left empty.
+			// Comments of values are kept, comments of sections are not.
+			EResult Load(Section&& section) noexcept;
+			// Copies the current contents into destination, e.g. to Write them. Each shard is copied
+			// consistently, but writes that happen meanwhile may show up in some shards only.
+			EResult CopyTo(Section& destination) const noexcept;
+		};
+
+	public:
+		class Defaults;
+
+		// Expected sections and keys with their types and ranges. Sections and keys get dense ids when they are added,
+		// so checking a parsed key is one lookup in the table of its section plus a switch over the expected type.
+		// Pass it in ParseOptions::schema to validate while parsing, or use Validate for trees built otherwise.
+		class Schema
+		{
+			friend class MiniPPFile;
+			friend class Defaults;
+
+		public:
+			struct KeyRule
+			{
+				EValueType type = EValueType::String;
+				bool required = true;
+				// Array: checked against the first element of non-empty arrays (arrays are homogeneous)
+				bool checkElementType = false;
+				EValueType elementType = EValueType::Int;
+				// inclusive bounds, Int and Float check the value, String the length and Array the element count
+				int64_t minInt = std::numeric_limits<int64_t>::min();
+				int64_t maxInt = std::numeric_limits<int64_t>::max();
+				double minFloat = -std::numeric_limits<double>::infinity();
+				double maxFloat = std::numeric_limits<double>::infinity();
+				size_t minSize = 0;
+				size_t maxSize = std::numeric_limits<size_t>::max();
+				// optional, see Defaults::Load(const Schema&)
+				std::shared_ptr<const Value> defaultValue;
+			};
+
+		private:
+			struct SectionRule
+			{
+				String path;
+				// unknown keys here and undeclared sections below this one are accepted
+				bool allowUnknown = false;
+				HashMap<String, uint32_t> keyIds;
+				Vector<String> keyNames;
+				Vector<KeyRule> keys;
+				uint32_t requiredCount = 0;
+			};
+
+			HashMap<String, uint32_t> m_sectionIds;
+			Vector<SectionRule> m_sections;
+
+			uint32_t InternSection(const String& path);
+			const SectionRule* FindSection(const String& path) const noexcept;
+			bool IsUnknownSectionAllowed(const String& path) const noexcept;
+			static EResult CheckValue(const KeyRule& rule, const Value* value) noexcept;
+			EResult CheckKey(const SectionRule* section, const String& sectionPath, const String& key, const Value* value, Vector<uint32_t>* requiredSeen) const noexcept;
+			EResult CheckRequired(const Section& root, const Vector<uint32_t>* requiredSeen) const noexcept;
+			EResult ValidateSection(const Section& section, const String& path) const noexcept;
+			EResult AddRules(const Section& section, const String& path);
+
+		public:
+			// Also declares the parent sections. The root section is "".
+			EResult AddSection(const String& path, bool allowUnknown = false);
+			EResult AddKey(const String& sectionPath, const String& key, const KeyRule& rule);
+
+			// A schema written in mini: every section lists its keys with a string like "int 1900..2100", "string? 1..64"
+			// or "array<float> 2..2". '?' marks optional keys, either bound of a range may be left out ("..10").
+			// A default in mini syntax may follow a '=': "int? 0..8 = 4", "string? = \"none\"".
+			// _allow_unknown = true lets a section take unknown keys and undeclared sub-sections.
+			EResult Parse(const std::string& path) noexcept;
+			EResult Parse(std::istream& input) noexcept;
+			static EResult ParseRule(const String& spec, KeyRule* destination) noexcept;
+
+			EResult Validate(const Section& root) const noexcept;
+			bool IsEmpty() const noexcept { return m_sections.empty(); }
+		};
+
+	public:
+		// Default values by path, numbered densely. Bound to a file (SetDefaults), every id resolves to the value
+		// in the tree or to its default once per reload, so reading one is an index instead of a failing lookup.
+		class Defaults
+		{
+		public:
+			using Id = uint32_t;
+			static constexpr Id InvalidId = std::numeric_limits<uint32_t>::max();
+
+		private:
+			HashMap<String, Id> m_ids;
+			Vector<String> m_paths;
+			Vector<std::shared_ptr<const Value>> m_values;
+
+		public:
+			// path is section.key, like for Section::GetValue. KeyAlreadyPresent unless allowOverwrite.
+			EResult Add(const String& path, std::shared_ptr<const Value> value, bool allowOverwrite = false);
+
+			// Copy every value of the tree (or file) / every default of the schema, replacing defaults of the same path.
+			// Ids that were handed out stay valid.
+			EResult Load(const Section& root);
+			EResult Load(const Schema& schema);
+			EResult Parse(const std::string& path) noexcept;
+			EResult Parse(std::istream& input) noexcept;
+
+			Id GetId(const String& path) const noexcept
+			{
+				auto it = m_ids.find(path);
+				return it != m_ids.end() ? it->second : InvalidId;
+			}
+			size_t GetCount() const noexcept { return m_values.size(); }
+			const String& GetPath(Id id) const noexcept { return m_paths[id]; }
+			const Value* GetDefault(Id id) const noexcept { return m_values[id].get(); }
+		};
+
+	public:
+		// Values (in mini syntax) that replace or add keys while a file is parsed, see ParseOptions::overrides.
+		class Overrides
+		{
+			friend class MiniPPFile;
+
+		private:
+			struct Entry
+			{
+				String sectionPath;
+				String key;
+				String text;
+			};
+
+			// section path -> key -> index into m_entries, so sections without overrides cost one lookup per header
+			HashMap<String, HashMap<String, uint32_t>> m_sections;
+			Vector<Entry> m_entries;
+
+			std::unique_ptr<Value> ParseEntry(uint32_t id, EResult* result) const;
+			const HashMap<String, uint32_t>* FindSection(const String& path) const noexcept;
+			static EResult SplitPath(const String& path, String& section, String& key);
+
+		public:
+			// path is section.key, a later Add for the same path replaces the earlier value.
+			// The value is parsed once here, so syntax errors show up right away.
+			EResult Add(const String& path, const String& value);
+			// "section.key=value", e.g. from the command line
+			EResult AddAssignment(const String& assignment);
+			// Every variable named prefix followed by the path, with "__" in place of the dots:
+			// MINIPP_game__window__dimensions=[1, 2] sets game.window.dimensions.
+			// Variables whose name isn't such a path (MINIPP_FOO) are skipped. A path with a value that doesn't
+			// parse is an error, returned after all other variables were added.
+			EResult AddFromEnvironment(const String& prefix = "MINIPP_");
+
+			size_t GetCount() const noexcept { return m_entries.size(); }
+		};
+
+	public:
+		struct SourcePosition
+		{
+			uint64_t offset = 0;	// bytes from the start of the stream to the first character
+			uint32_t line = 0;		// 1-based
+			uint32_t column = 0;	// 1-based, in bytes
+			uint32_t length = 0;	// of the section header or the key-value line, surrounding whitespace excluded
+		};
+
+		// Where Parse found each section header and key-value pair, see ParseOptions::sourceMap. The nodes themselves
+		// don't grow: they map to dense ids (in file order) and the positions live in an array indexed by them.
+		// Sections that only exist as part of a longer path ([a.b] creates a) and overridden keys the file doesn't
+		// have get no position.
+		class SourceMap
+		{
+			friend class MiniPPFile;
+
+		public:
+			using Id = uint32_t;
+			static constexpr Id InvalidId = std::numeric_limits<uint32_t>::max();
+
+		private:
+			HashMap<const void*, Id> m_ids;
+			Vector<SourcePosition> m_positions;
+
+			void Record(const void* node, const SourcePosition& position);
+			Id FindId(const void* node) const noexcept
+			{
+				auto it = m_ids.find(node);
+				return it != m_ids.end() ? it->second : InvalidId;
+			}
+
+		public:
+			Id GetId(const Value* value) const noexcept { return FindId(value); }
+			Id GetId(const Section* section) const noexcept { return FindId(section); }
+			// nullptr for nodes without a position
+			const SourcePosition* Find(const Value* value) const noexcept { return Find(FindId(value)); }
+			const SourcePosition* Find(const Section* section) const noexcept { return Find(FindId(section)); }
+			const SourcePosition* Find(Id id) const noexcept { return id < m_positions.size() ? &m_positions[id] : nullptr; }
+
+			size_t GetCount() const noexcept { return m_positions.size(); }
+			void Clear() noexcept;
+		};
+
+	public:
+		struct ParseOptions
+		{
+			// Receives the positions of the parsed nodes, which stay valid as long as the nodes aren't deleted.
+			// Cleared unless the parse is additional. Must outlive the Parse call.
+			SourceMap* sourceMap = nullptr;
+
+			// Applied in the same pass: an override replaces the value of its key in the file, which must be of the same
+			// kind (InvalidDataType otherwise, for arrays the element type counts too). Overrides of keys the file
+			// doesn't have are added after the last line. Must outlive the Parse call.
+			const Overrides* overrides = nullptr;
+
+			// Checked in the same pass: SchemaViolation on the first value, key or section that doesn't match.
+			// Must outlive the Parse call.
+			const Schema* schema = nullptr;
+
+			// Arrays whose source text is at least this many bytes long are parsed with ArrayValue::ParseLazy,
+			// so only the elements that are actually accessed get boxed into Values. Validation isn't relaxed:
+			// every element is still checked during Parse and fails it with the same error. 0 disables lazy arrays.
+			size_t lazyArrayThreshold = 0;
+
+			// Scans the (seekable) stream once before parsing to count the keys and sub-sections of every section,
+			// so their hash maps are reserved up front instead of rehashing while they grow. Pays off for big sections.
+			bool reserveFromPreScan = false;
+		};
+
+		struct WriteOptions
+		{
+			// With more than one thread every top-level sub-section is serialized into its own buffer on a worker,
+			// the buffers are written in the usual order afterwards (with writev when writing to a path on POSIX).
+			// With MINIPP_USE_PMR, lazy arrays parse their elements from their resource while being written,
+			// which then has to be thread-safe.
+			unsigned threadCount = 1;
+		};
+
+	public:
+		MiniPPFile() = default;
+#if MINIPP_USE_PMR
+		// the document and everything Parse adds to it is allocated from resource, which must outlive the file
+		explicit MiniPPFile(std::pmr::memory_resource* resource) noexcept;
+#endif
+		MiniPPFile(MiniPPFile&& other) noexcept;
+		MiniPPFile& operator=(MiniPPFile&& other) noexcept;
+		~MiniPPFile();
+
+		// O(1) apart from re-resolving handles: e.g. parse into a fresh file and swap it into place once it succeeded.
+		// The memory resource stays with the object, like with std::pmr containers.
+		void Swap(MiniPPFile& other) noexcept;
+		friend void swap(MiniPPFile& first, MiniPPFile& second) noexcept { first.Swap(second); }
+
+	private:
+#if MINIPP_USE_PMR
+		std::pmr::memory_resource* m_memoryResource = detail::GetMemoryResource();
+#endif
+#if MINIPP_ENABLE_VALUE_POOL
+		ValuePool* m_valuePool = nullptr;
+#endif
+		Section m_rootSection{};
+
+	private:
+		static minipp::EResult SerializeValues(const Section* section, String& destination) noexcept;
+		static minipp::EResult SerializeSection(const Section* section, String& destination, const String& path) noexcept;
+		static minipp::EResult SerializeSubSection(const String& name, const Section* section, String& destination, const String& parentPath) noexcept;
+		EResult SerializeParallel(unsigned threadCount, Vector<String>& buffers) const noexcept;
+		template<typename ChunkConsumer>
+		EResult SerializeChunks(ChunkConsumer consumer) const noexcept;
+		static size_t MeasureSection(const Section* section, size_t pathLength) noexcept;
+		static EResult WriteJsonSection(const Section* section, String& buffer, OutputSink& sink) noexcept;
+
+		struct SectionSizeHint
+		{
+			size_t valueCount = 0;
+			size_t subSectionCount = 0;
+		};
+
+		// keyed by section path, "" is the root section
+		using SectionSizeHints = HashMap<String, SectionSizeHint>;
+		static void PreScan(std::istream& input, SectionSizeHints& hints);
+
+		class JsonReader;
+		class JsonTreeBuilder;
+		class JsonMiniConverter;
+
+	public:
+		EResult Parse(const std::string& path, bool additional = false) noexcept;
+		EResult Parse(std::ifstream& ifs, bool additional = false) noexcept;
+		EResult Parse(const std::string& path, const ParseOptions& options, bool additional = false) noexcept;
+		EResult Parse(std::ifstream& ifs, const ParseOptions& options, bool additional = false) noexcept;
+		// Any stream, e.g. std::cin. reserveFromPreScan is skipped for streams that can't seek.
+		EResult Parse(std::istream& input, bool additional = false) noexcept;
+		EResult Parse(std::istream& input, const ParseOptions& options, bool additional = false) noexcept;
+		EResult Write(const std::string& path) const noexcept;
+		EResult Write(std::ofstream& ofs) const noexcept;
+		EResult Write(const std::string& path, const WriteOptions& options) const noexcept;
+		EResult Write(std::ofstream& ofs, const WriteOptions& options) const noexcept;
+		EResult Write(OutputSink& sink) const noexcept;
+		EResult Write(OutputSink& sink, const WriteOptions& options) const noexcept;
+
+		// Adds a codec or replaces the one for the same extension. Not thread-safe against files being read or
+		// written, register codecs at startup.
+		static void RegisterCodec(const Codec& codec);
+		// false unless a codec is registered for the extension of path
+		static bool FindCodec(const std::string& path, Codec* destination);
+
+		// Exact number of bytes Write produces for the current tree.
+		size_t MeasureSerializedSize() const noexcept;
+		// Measures first, so destination is allocated exactly once.
+		EResult WriteToBuffer(String& destination) const noexcept;
+		// BufferTooSmall if capacity is less than MeasureSerializedSize(). written (optional) receives the byte count.
+		EResult WriteToBuffer(char* destination, size_t capacity, size_t* written = nullptr) const noexcept;
+		// Sizes the file up front and serializes straight into a shared mapping of it (POSIX),
+		// elsewhere this is WriteToBuffer followed by a single write.
+		EResult WriteMapped(const std::string& path) const noexcept;
+
+		// Streams the tree as one compact JSON object: sections and their values become members, arrays stay arrays.
+		// Comments are dropped, non-finite floats become null. Output goes to sink in chunks of about 64 KiB.
+		EResult WriteJson(OutputSink& sink) const noexcept;
+
+		// Reads one JSON object in a single pass: objects become sections, arrays ArrayValues, numbers without fraction
+		// or exponent that fit into int64_t IntValues and all other numbers FloatValues. Members that are null are skipped.
+		// Like in mini, values need a section (KeyValuePairNotInSection for values of the top-level object) and arrays
+		// must be homogeneous (ArrayDataTypeInconsistency), objects and null inside arrays are InvalidDataType.
+		EResult ImportJson(std::istream& input, bool additional = false) noexcept;
+		// Same mapping, but converted straight into mini text. Only nested objects are held back until their parent
+		// object ends (mini lists the keys of a section before its sub-sections), the rest streams through writer.
+		// Duplicate JSON members are not detected here.
+		static EResult ImportJson(std::istream& input, MiniWriter& writer) noexcept;
+
+	public:
+		const Section& GetRoot() const noexcept { return m_rootSection; }
+		Section& GetRoot() noexcept { return m_rootSection; }
+
+#if MINIPP_ENABLE_VALUE_POOL
+		// Opt-in: values created by Parse (and under a ValuePool::Scope of GetValuePool()) are pooled from now on.
+		void EnableValuePool();
+		ValuePool* GetValuePool() noexcept { return m_valuePool; }
+#endif
+#if MINIPP_USE_PMR
+		std::pmr::memory_resource* GetMemoryResource() const noexcept { return m_memoryResource; }
+#endif
+
+	private:
+		struct HandleSlot
+		{
+			String path;
+			std::atomic<Value*> value{ nullptr };
+			std::atomic<uint64_t> generation{ 0 };
+			// nullptr unless the value has the handle's type
+			Value* (*filter)(Value* value) noexcept = nullptr;
+
+			void Assign(Value* target) noexcept
+			{
+				if (value.load(std::memory_order_relaxed) == target)
+					return;
+				value.store(target, std::memory_order_release);
+				generation.fetch_add(1, std::memory_order_release);
+			}
+		};
+
+		struct Watcher
+		{
+			String path;
+
+			virtual ~Watcher() = default;
+			virtual void Refresh(Section& root) noexcept = 0;
+		};
+
+		template<typename BaseType>
+		struct WatchSlot : Watcher
+		{
+			BaseType value;
+			BaseType defaultValue;
+			std::atomic<uint64_t> generation{ 0 };
+			// false unless the value at path has the watched type
+			bool (*read)(Section& root, const String& path, BaseType& destination) = nullptr;
+
+			void Refresh(Section& root) noexcept override
+			{
+				BaseType next = defaultValue;
+				read(root, path, next);
+				if (value == next)
+					return;
+				value = std::move(next);
+				generation.fetch_add(1, std::memory_order_release);
+			}
+		};
+
+		Vector<std::weak_ptr<HandleSlot>> m_handles;
+		Vector<std::weak_ptr<Watcher>> m_watchers;
+		const Defaults* m_defaults = nullptr;
+		// per Defaults::Id: the value in the tree if it has the default's type, the default otherwise
+		Vector<const Value*> m_defaultsTable;
+
+		void BindDefaults() noexcept;
+
+		EResult ParseStream(std::istream& input, const ParseOptions& options, bool additional) noexcept;
+		static EResult CheckOverrideKind(const Value* original, const Value* replacement) noexcept;
+		EResult AddRemainingOverrides(const Overrides& overrides, const Vector<uint8_t>& applied, const Schema* schema, Vector<uint32_t>* requiredSeen) noexcept;
+		void InvalidateHandles() noexcept;
+
+	public:
+		// Refers to the value at a path of a file rather than to one Value object: Parse, ImportJson, Swap and
+		// move assignment point it at whatever the path resolves to afterwards, so it never has to be looked up again.
+		// Get is a single atomic load and nullptr while the path doesn't resolve to a ValueDataType (or the file is gone).
+		// Handles don't make reloading thread-safe, the values a handle returned die with the reload.
+		// After editing the tree by hand, call RefreshHandles.
+		template<typename ValueDataType>
+		class Handle
+		{
+			static_assert(std::is_base_of<Value, ValueDataType>::value, "ValueDataType must be a subclass of Value");
+			friend class MiniPPFile;
+
+		private:
+			std::shared_ptr<HandleSlot> m_slot;
+
+			explicit Handle(std::shared_ptr<HandleSlot> slot) noexcept : m_slot(std::move(slot)) {}
+
+		public:
+			Handle() = default;
+
+			ValueDataType* Get() const noexcept
+			{
+				return m_slot != nullptr ? static_cast<ValueDataType*>(m_slot->value.load(std::memory_order_acquire)) : nullptr;
+			}
+			ValueDataType* operator->() const noexcept { return Get(); }
+			explicit operator bool() const noexcept { return Get() != nullptr; }
+
+			// Changes whenever the handle starts pointing at another Value, e.g. to tell whether a cached copy is stale.
+			uint64_t GetGeneration() const noexcept { return m_slot != nullptr ? m_slot->generation.load(std::memory_order_acquire) : 0; }
+			const String* GetPath() const noexcept { return m_slot != nullptr ? &m_slot->path : nullptr; }
+
+			typename ValueDataType::BaseType GetValueOrDefault(
+				const typename ValueDataType::BaseType& defaultValue = typename ValueDataType::BaseType{}) const
+			{
+				auto value = Get();
+				return value != nullptr ? value->GetValue() : defaultValue;
+			}
+		};
+
+		// path is a value path relative to the root, like for Section::GetValue. Unresolved paths are fine,
+		// the handle starts resolving once a reload adds the value.
+		template<typename ValueDataType>
+		Handle<ValueDataType> GetHandle(const String& path)
+		{
+			auto slot = std::make_shared<HandleSlot>();
+			slot->path = path;
+			slot->filter = [](Value* value) noexcept -> Value* { return dynamic_cast<ValueDataType*>(value); };
+			m_handles.push_back(slot);
+			Value* value = nullptr;
+			if (m_rootSection.GetValue(path, &value) == EResult::Success)
+				slot->Assign(slot->filter(value));
+			return Handle<ValueDataType>(std::move(slot));
+		}
+
+		// A copy of the value at a path, converted once and kept up to date the same way as a Handle: reading it
+		// is a plain load, no lookup, cast or check. Falls back to the default while the path doesn't resolve to the
+		// watched type. Changes to the Value object itself (rather than to which Value is at the path) need RefreshHandles.
+		// Like handles, cached values must not be read while the file reloads on another thread.
+		template<typename BaseType>
+		class CachedValue
+		{
+			friend class MiniPPFile;
+
+		private:
+			std::shared_ptr<WatchSlot<BaseType>> m_slot;
+
+			explicit CachedValue(std::shared_ptr<WatchSlot<BaseType>> slot) noexcept : m_slot(std::move(slot)) {}
+
+		public:
+			const BaseType& Get() const noexcept { return m_slot->value; }
+			operator const BaseType&() const noexcept { return m_slot->value; }
+
+			// Changes whenever a refresh produced a different value.
+			uint64_t GetGeneration() const noexcept { return m_slot->generation.load(std::memory_order_acquire); }
+			const String& GetPath() const noexcept { return m_slot->path; }
+		};
+
+		template<typename ValueDataType>
+		CachedValue<typename ValueDataType::BaseType> Watch(const String& path,
+			const typename ValueDataType::BaseType& defaultValue = typename ValueDataType::BaseType{})
+		{
+			static_assert(std::is_base_of<Value, ValueDataType>::value, "ValueDataType must be a subclass of Value");
+			static_assert(!std::is_same<ValueDataType, Values::ArrayValue>::value, "arrays can't be watched, use a Handle");
+			using BaseType = typename ValueDataType::BaseType;
+
+			auto slot = std::make_shared<WatchSlot<BaseType>>();
+			slot->path = path;
+			slot->value = defaultValue;
+			slot->defaultValue = defaultValue;
+			slot->read = [](Section& root, const String& path, BaseType& destination)
+			{
+				ValueDataType* value = nullptr;
+				if (root.GetValue(path, &value) != EResult::Success)
+					return false;
+				destination = value->GetValue();
+				return true;
+			};
+			slot->Refresh(m_rootSection);
+			slot->generation.store(0, std::memory_order_relaxed);
+			m_watchers.push_back(slot);
+			return CachedValue<BaseType>(std::move(slot));
+		}
+
+		// Re-resolves every handle, cached value and default and forgets the handles that were destroyed.
+		// Parse and ImportJson do this themselves.
+		void RefreshHandles() noexcept;
+
+		// defaults (nullptr to unbind) must outlive the binding and not change while bound.
+		void SetDefaults(const Defaults* defaults) noexcept;
+		const Defaults* GetDefaults() const noexcept { return m_defaults; }
+
+		// The value at the path of id, its default if the tree doesn't have it (with that type).
+		// nullptr if id is invalid or the default isn't a ValueDataType.
+		template<typename ValueDataType>
+		const ValueDataType* GetValue(Defaults::Id id) const noexcept
+		{
+			static_assert(std::is_base_of<Value, ValueDataType>::value, "ValueDataType must be a subclass of Value");
+			if (id >= m_defaultsTable.size() || m_defaultsTable[id]->GetType() != ValueDataType::Type)
+				return nullptr;
+			return static_cast<const ValueDataType*>(m_defaultsTable[id]);
+		}
+
+	public:
+		static bool IsResultOk(EResult result) noexcept;
+
+		// The scanning kernels (string escapes, array tokenizer, number classification, digit conversion) are picked
+		// via cpuid on first use. ForceSimdLevel overrides that choice, clamped to what the CPU supports.
+		static ESimdLevel GetSimdLevel() noexcept;
+		static ESimdLevel ForceSimdLevel(ESimdLevel level) noexcept;
+
+	private:
+		class Tools
+		{
+		public:
+			static bool StringStartsWith(const String& str, const String& beg);
+			static bool StringEndsWith(const String& str, const String& end);
+			static void StringTrim(String& str);
+			static bool IsNameValid(const String& name) noexcept;
+			static int64_t FirstIndexOf(const String& str, char c) noexcept;
+			static int64_t LastIndexOf(const String& str, char c) noexcept;
+			static std::pair<String, String> SplitInTwo(const String& str, int64_t firstLength) noexcept;
+			static Vector<String> SplitByDelimiter(const String& str, char delimiter) noexcept;
+			static void RemoveAll(String& str, char old);
+			static bool IsIntegerDecimal(const String& str) noexcept;
+
+			// Value formatting shared by Values::*::ToString and MiniWriter, appended to destination
+			static void AppendEscapedString(String& destination, const char* data, size_t size);
+			static EResult AppendInt(String& destination, int64_t value, EIntStyle style);
+			static void AppendFloat(String& destination, double value);
+			static void AppendJsonString(String& destination, const char* data, size_t size);
+			static void AppendJsonFloat(String& destination, double value);
+			static size_t MeasureEscapedString(const char* data, size_t size) noexcept;
+			static size_t MeasureInt(int64_t value, EIntStyle style) noexcept;
+			static size_t MeasureFloat(double value) noexcept;
+
+			using ENumericClass = detail::ENumericClass;
+
+			// These forward to the kernels selected for the current CPU (see ForceSimdLevel)
+			static ENumericClass ClassifyNumeric(const char* data, size_t size) noexcept;
+			static size_t FindFirstOf(const char* data, size_t size, const char* set, size_t setSize) noexcept;
+			// Converts the ASCII digits at the start of data, at most 16 of them, into value
+			// and returns how many there were (0 if data doesn't start with a digit).
+			static size_t ParseDigits(const char* data, size_t size, uint64_t* value) noexcept;
+		};
+	};
+}
+
+#ifdef MINIPP_IMPLEMENTATION
+
+#include <fstream>
+#include <typeinfo>
+#include <sstream>
+#include <bitset>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <cerrno>
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#include <system_error>
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define MINIPP_X86 1
+	#if !defined(_MSC_VER)
+		#include <cpuid.h>
+	#endif
+	#include <immintrin.h>
+#else
+	#define MINIPP_X86 0
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+	#define MINIPP_POSIX 1
+	#include <climits>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <sys/uio.h>
+	#include <unistd.h>
+#else
+	#define MINIPP_POSIX 0
+#endif
+
+#if MINIPP_WITH_ZLIB
+	#include <zlib.h>
+#endif
+#if MINIPP_WITH_ZSTD
+	#include <zstd.h>
+#endif
+
+#if defined(__APPLE__)
+	#include <crt_externs.h>
+	#define MINIPP_ENVIRONMENT (*_NSGetEnviron())
+#elif defined(_WIN32)
+	#define MINIPP_ENVIRONMENT _environ
+#else
+	extern "C" char** environ;
+	#define MINIPP_ENVIRONMENT environ
+#endif
+
+// lets single kernels use instruction sets the rest of the translation unit isn't compiled for
+#if defined(__GNUC__) || defined(__clang__)
+	#define MINIPP_TARGET(isa) __attribute__((target(isa)))
+#else
+	#define MINIPP_TARGET(isa)
+#endif
+
+// the SWAR digit tricks assume the first character of a chunk ends up in the lowest byte
+#if defined(_MSC_VER) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	#define MINIPP_HAS_SWAR 1
+#else
+	#define MINIPP_HAS_SWAR 0
+#endif
+
+#if MINIPP_ENABLE_DEBUG_OUTPUT
+#include <iostream>
+	#define PP_COUT(msg) MINIPP_DEBUG_STREAM << "[minipp] " << msg << std::endl
+#else
+	#define PP_COUT(msg)
+#endif
+
+#define PP_COUT_SYNTAX_ERROR_LINE(line, msg) PP_COUT(line << ": " << msg)
+#define PP_COUT_SYNTAX_ERROR(msg) PP_COUT("Syntax error: " << msg)
+
+#pragma region Kernels
+namespace minipp
+{
+	namespace detail
+	{
+		struct Kernels
+		{
+			ESimdLevel level;
+			ENumericClass(*classifyNumeric)(const char* data, size_t size);
+			size_t(*findFirstOf)(const char* data, size_t size, const char* set, size_t setSize);
+			size_t(*parseDigits)(const char* data, size_t size, uint64_t* value);
+		};
+
+		// 16 digits stay below 10^16, so a run always fits and callers only check overflow when combining runs
+		constexpr size_t MaxDigitRun = 16;
+		constexpr uint64_t PowersOfTen[MaxDigitRun + 1] = {
+			1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+			10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+			1000000000000000ULL, 10000000000000000ULL
+		};
+
+		// SWAR on eight ASCII digits loaded into a little-endian word (first digit in the lowest byte)
+		inline bool IsEightDigits(uint64_t chunk) noexcept
+		{
+			return (((chunk & 0xF0F0F0F0F0F0F0F0) |
+				(((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333);
+		}
+
+		inline uint32_t ParseEightDigits(uint64_t chunk) noexcept
+		{
+			// converts 8 ASCII digits (first digit in the lowest byte) with three multiplications
+			constexpr uint64_t mask = 0x000000FF000000FF;
+			constexpr uint64_t mul1 = 100 + (1000000ULL << 32);
+			constexpr uint64_t mul2 = 1 + (10000ULL << 32);
+			chunk -= 0x3030303030303030;
+			chunk = (chunk * 10) + (chunk >> 8);
+			chunk = (((chunk & mask) * mul1) + (((chunk >> 16) & mask) * mul2)) >> 32;
+			return static_cast<uint32_t>(chunk);
+		}
+
+		static ENumericClass CombineNumericClass(bool isFloat, ENumericClass tail) noexcept
+		{
+			if (tail == ENumericClass::None)
+				return ENumericClass::None;
+			return isFloat ? ENumericClass::Float : tail;
+		}
+
+		static ENumericClass ClassifyNumericScalar(const char* data, size_t size)
+		{
+			bool isFloat = false;
+			for (size_t i = 0; i < size; ++i)
+			{
+				char c = data[i];
+				if ((c >= '0' && c <= '9') || c == ',' || c == ' ' || c == '\t')
+					continue;
+				if (c == '.' || c == 'f' || c == 'e' || c == 'E' || c == '-' || c == '+')
+					isFloat = true;
+				else
+					return ENumericClass::None;
+			}
+
+			return isFloat ? ENumericClass::Float : ENumericClass::Integer;
+		}
+
+		static size_t FindFirstOfScalar(const char* data, size_t size, const char* set, size_t setSize)
+		{
+			for (size_t i = 0; i < size; ++i)
+				for (size_t j = 0; j < setSize; ++j)
+					if (data[i] == set[j])
+						return i;
+
+			return size;
+		}
+
+		static size_t ParseDigitsScalar(const char* data, size_t size, uint64_t* value)
+		{
+			size_t limit = size < MaxDigitRun ? size : MaxDigitRun;
+			uint64_t result = 0;
+			size_t i = 0;
+#if MINIPP_HAS_SWAR
+			for (; i + 8 <= limit; i += 8)
+			{
+				uint64_t chunk;
+				std::memcpy(&chunk, data + i, sizeof(chunk));
+				if (!IsEightDigits(chunk))
+					break;
+				result = result * 100000000 + ParseEightDigits(chunk);
+			}
+#endif
+			for (; i < limit && data[i] >= '0' && data[i] <= '9'; ++i)
+				result = result * 10 + static_cast<uint64_t>(data[i] - '0');
+
+			*value = result;
+			return i;
+		}
+
+#if MINIPP_X86
+		MINIPP_TARGET("sse4.2")
+		static ENumericClass ClassifyNumericSse42(const char* data, size_t size)
+		{
+			const __m128i belowZero = _mm_set1_epi8('0' - 1);
+			const __m128i aboveNine = _mm_set1_epi8('9' + 1);
+			bool isFloat = false;
+			size_t i = 0;
+			for (; i + 16 <= size; i += 16)
+			{
+				__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+				__m128i digits = _mm_and_si128(_mm_cmpgt_epi8(chunk, belowZero), _mm_cmplt_epi8(chunk, aboveNine));
+				__m128i intChars = _mm_or_si128(
+					_mm_or_si128(digits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(','))),
+					_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'))));
+				__m128i floatChars = _mm_or_si128(
+					_mm_or_si128(
+						_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('.')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('f'))),
+						_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('e')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('E')))),
+					_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('-')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('+'))));
+
+				if (_mm_movemask_epi8(_mm_or_si128(intChars, floatChars)) != 0xFFFF)
+					return ENumericClass::None;
+				if (_mm_movemask_epi8(intChars) != 0xFFFF)
+					isFloat = true;
+			}
+
+			return CombineNumericClass(isFloat, ClassifyNumericScalar(data + i, size - i));
+		}
+
+		MINIPP_TARGET("sse4.2")
+		static size_t FindFirstOfSse42(const char* data, size_t size, const char* set, size_t setSize)
+		{
+			// pcmpestri does the whole "equal any" comparison against up to 16 set characters at once
+			char setBuffer[16] = {};
+			std::memcpy(setBuffer, set, setSize);
+			const __m128i setChars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(setBuffer));
+			const int setLength = static_cast<int>(setSize);
+
+			size_t i = 0;
+			for (; i + 16 <= size; i += 16)
+			{
+				__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+				int index = _mm_cmpestri(setChars, setLength, chunk, 16,
+					_SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_LEAST_SIGNIFICANT);
+				if (index != 16)
+					return i + static_cast<size_t>(index);
+			}
+
+			return i + FindFirstOfScalar(data + i, size - i, set, setSize);
+		}
+
+		MINIPP_TARGET("sse4.2")
+		static size_t ParseDigitsSse42(const char* data, size_t size, uint64_t* value)
+		{
+			if (size < 16)
+				return ParseDigitsScalar(data, size, value);
+
+			// the digits are the bytes that are at most 9 after subtracting '0' (unsigned)
+			__m128i chunk = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), _mm_set1_epi8('0'));
+			__m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(chunk, _mm_set1_epi8(9)), chunk);
+			size_t count = CountTrailingZeros(~static_cast<uint64_t>(_mm_movemask_epi8(isDigit)));
+			if (count == 0)
+			{
+				*value = 0;
+				return 0;
+			}
+
+			// right-aligns the run, pshufb zeroes the lanes whose index went negative (leading zeros)
+			__m128i shuffle = _mm_sub_epi8(_mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+				_mm_set1_epi8(static_cast<char>(16 - count)));
+			chunk = _mm_shuffle_epi8(chunk, shuffle);
+
+			// 16 digits -> 8 pairs -> 4 quads -> 2 halves of eight digits each
+			chunk = _mm_maddubs_epi16(chunk, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+			chunk = _mm_madd_epi16(chunk, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+			chunk = _mm_packus_epi32(chunk, chunk);
+			chunk = _mm_madd_epi16(chunk, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+
+			*value = static_cast<uint64_t>(static_cast<uint32_t>(_mm_cvtsi128_si32(chunk))) * 100000000 +
+				static_cast<uint32_t>(_mm_extract_epi32(chunk, 1));
+			return count;
+		}
+
+		MINIPP_TARGET("avx2")
+		static ENumericClass ClassifyNumericAvx2(const char* data, size_t size)
+		{
+			const __m256i belowZero = _mm256_set1_epi8('0' - 1);
+			const __m256i aboveNine = _mm256_set1_epi8('9' + 1);
+			bool isFloat = false;
+			size_t i = 0;
+			for (; i + 32 <= size; i += 32)
+			{
+				__m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+				__m256i digits = _mm256_and_si256(_mm256_cmpgt_epi8(chunk, belowZero), _mm256_cmpgt_epi8(aboveNine, chunk));
+				__m256i intChars = _mm256_or_si256(
+					_mm256_or_si256(digits, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(','))),
+					_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t'))));
+				__m256i floatChars = _mm256_or_si256(
+					_mm256_or_si256(
+						_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('.')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('f'))),
+						_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('e')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('E')))),
+					_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('-')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('+'))));
+
+				if (static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(intChars, floatChars))) != 0xFFFFFFFFu)
+					return ENumericClass::None;
+				if (static_cast<uint32_t>(_mm256_movemask_epi8(intChars)) != 0xFFFFFFFFu)
+					isFloat = true;
+			}
+
+			return CombineNumericClass(isFloat, ClassifyNumericSse42(data + i, size - i));
+		}
+
+		MINIPP_TARGET("avx2")
+		static size_t FindFirstOfAvx2(const char* data, size_t size, const char* set, size_t setSize)
+		{
+			__m256i setChars[16];
+			for (size_t j = 0; j < setSize; ++j)
+				setChars[j] = _mm256_set1_epi8(set[j]);
+
+			size_t i = 0;
+			for (; i + 32 <= size; i += 32)
+			{
+				__m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+				__m256i matches = _mm256_setzero_si256();
+				for (size_t j = 0; j < setSize; ++j)
+					matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(chunk, setChars[j]));
+
+				uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(matches));
+				if (mask != 0)
+					return i + CountTrailingZeros(mask);
+			}
+
+			return i + FindFirstOfSse42(data + i, size - i, set, setSize);
+		}
+
+		MINIPP_TARGET("avx512f,avx512bw")
+		static ENumericClass ClassifyNumericAvx512(const char* data, size_t size)
+		{
+			const __m512i belowZero = _mm512_set1_epi8('0' - 1);
+			const __m512i aboveNine = _mm512_set1_epi8('9' + 1);
+			bool isFloat = false;
+			size_t i = 0;
+			for (; i + 64 <= size; i += 64)
+			{
+				__m512i chunk = _mm512_loadu_si512(data + i);
+				__mmask64 digits = _mm512_cmpgt_epi8_mask(chunk, belowZero) & _mm512_cmpgt_epi8_mask(aboveNine, chunk);
+				__mmask64 intChars = digits |
+					_mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8(',')) |
+					_mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8(' ')) |
+					_mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('\t'));
+				__mmask64 floatChars =
+					_mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('.')) |
+					_mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('f')) |
+					_mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('e')) |
+					_mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('E')) |
+					_mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('-')) |
+					_mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('+'));
+
+				if ((intChars | floatChars) != ~static_cast<__mmask64>(0))
+					return ENumericClass::None;
+				if (intChars != ~static_cast<__mmask64>(0))
+					isFloat = true;
+			}
+
+			return CombineNumericClass(isFloat, ClassifyNumericAvx2(data + i, size - i));
+		}
+
+		MINIPP_TARGET("avx512f,avx512bw")
+		static size_t FindFirstOfAvx512(const char* data, size_t size, const char* set, size_t setSize)
+		{
+			__m512i setChars[16];
+			for (size_t j = 0; j < setSize; ++j)
+				setChars[j] = _mm512_set1_epi8(set[j]);
+
+			size_t i = 0;
+			for (; i + 64 <= size; i += 64)
+			{
+				__m512i chunk = _mm512_loadu_si512(data + i);
+				__mmask64 matches = 0;
+				for (size_t j = 0; j < setSize; ++j)
+					matches |= _mm512_cmpeq_epi8_mask(chunk, setChars[j]);
+
+				if (matches != 0)
+					return i + CountTrailingZeros(matches);
+			}
+
+			return i + FindFirstOfAvx2(data + i, size - i, set, setSize);
+		}
+
+		static void CpuId(uint32_t leaf, uint32_t subLeaf, uint32_t registers[4]) noexcept
+		{
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuidex(info, static_cast<int>(leaf), static_cast<int>(subLeaf));
+			for (int i = 0; i < 4; ++i)
+				registers[i] = static_cast<uint32_t>(info[i]);
+#else
+			__cpuid_count(leaf, subLeaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+		}
+
+		static uint64_t ReadXcr0() noexcept
+		{
+#if defined(_MSC_VER)
+			return _xgetbv(0);
+#else
+			uint32_t eax, edx;
+			__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+			return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+		}
+#endif
+
+		static ESimdLevel DetectSimdLevel() noexcept
+		{
+#if MINIPP_X86
+			uint32_t registers[4] = {}; // eax, ebx, ecx, edx
+			CpuId(0, 0, registers);
+			uint32_t maxLeaf = registers[0];
+
+			CpuId(1, 0, registers);
+			bool hasSse42 = (registers[2] & (1u << 20)) != 0;
+			bool hasOsXSave = (registers[2] & (1u << 27)) != 0;
+			bool hasAvx = (registers[2] & (1u << 28)) != 0;
+			if (!hasSse42)
+				return ESimdLevel::Scalar;
+
+			// the OS has to save the ymm / zmm registers for us, otherwise the instructions fault
+			if (!hasOsXSave || !hasAvx || maxLeaf < 7)
+				return ESimdLevel::SSE42;
+			uint64_t xcr0 = ReadXcr0();
+			if ((xcr0 & 0x6) != 0x6)
+				return ESimdLevel::SSE42;
+
+			CpuId(7, 0, registers);
+			bool hasAvx2 = (registers[1] & (1u << 5)) != 0;
+			bool hasAvx512F = (registers[1] & (1u << 16)) != 0;
+			bool hasAvx512BW = (registers[1] & (1u << 30)) != 0;
+			if (!hasAvx2)
+				return ESimdLevel::SSE42;
+			if (hasAvx512F && hasAvx512BW && (xcr0 & 0xE6) == 0xE6)
+				return ESimdLevel::AVX512;
+			return ESimdLevel::AVX2;
+#else
+			return ESimdLevel::Scalar;
+#endif
+		}
+
+		static const Kernels* GetKernelsForLevel(ESimdLevel level) noexcept
+		{
+			static const Kernels scalarKernels = { ESimdLevel::Scalar, &ClassifyNumericScalar, &FindFirstOfScalar, &ParseDigitsScalar };
+#if MINIPP_X86
+			// a digit run never fills more than 16 bytes (see MaxDigitRun), so the wider levels share the SSE4.2 conversion
+			static const Kernels sse42Kernels = { ESimdLevel::SSE42, &ClassifyNumericSse42, &FindFirstOfSse42, &ParseDigitsSse42 };
+			static const Kernels avx2Kernels = { ESimdLevel::AVX2, &ClassifyNumericAvx2, &FindFirstOfAvx2, &ParseDigitsSse42 };
+			static const Kernels avx512Kernels = { ESimdLevel::AVX512, &ClassifyNumericAvx512, &FindFirstOfAvx512, &ParseDigitsSse42 };
+
+			switch (level)
+			{
+			case ESimdLevel::SSE42:
+				return &sse42Kernels;
+			case ESimdLevel::AVX2:
+				return &avx2Kernels;
+			case ESimdLevel::AVX512:
+				return &avx512Kernels;
+			default: break;
+			}
+#else
+			(void)level;
+#endif
+			return &scalarKernels;
+		}
+
+		static std::atomic<const Kernels*> g_kernels{ nullptr };
+
+		static const Kernels& GetKernels() noexcept
+		{
+			const Kernels* kernels = g_kernels.load(std::memory_order_acquire);
+			if (kernels == nullptr)
+			{
+				// racing threads all detect the same level, so whoever stores last doesn't matter
+				kernels = GetKernelsForLevel(DetectSimdLevel());
+				g_kernels.store(kernels, std::memory_order_release);
+			}
+			return *kernels;
+		}
+	}
+}
+#pragma endregion
+
+std::unique_ptr<minipp::MiniPPFile::Value> minipp::MiniPPFile::Value::ParseValue(String value, EResult* result)
+{
+#define RETURN_NULLPTR_WITH_RESULT(r) { if (result != nullptr) *result = r; return nullptr; }
+
+	char valueFirstChar = value.front();
+	char valueLastChar = value.back();
+	if (valueFirstChar == '"')
+	{
+		if (valueLastChar != '"')
+			RETURN_NULLPTR_WITH_RESULT(EResult::MissingQuote);
+
+		// is string
+		value = value.substr(1, value.size() - 2);
+		auto strValue = std::make_unique<Values::StringValue>();
+		auto parseResult = strValue->Parse(value);
+		if (!IsResultOk(parseResult))
+			RETURN_NULLPTR_WITH_RESULT(parseResult);
+
+		return strValue;
+	}
+	else if (valueLastChar == 'e')
+	{
+		auto boolValue = std::make_unique<Values::BooleanValue>();
+		auto parseResult = boolValue->Parse(value);
+		if (!IsResultOk(parseResult))
+			RETURN_NULLPTR_WITH_RESULT(parseResult);
+
+		return boolValue;
+	}
+	else if (valueLastChar == 'f')
+	{
+		auto floatValue = std::make_unique<Values::FloatValue>();
+		auto parseResult = floatValue->Parse(value);
+		if (!IsResultOk(parseResult))
+			RETURN_NULLPTR_WITH_RESULT(parseResult);
+
+		return floatValue;
+	}
+	else if (valueLastChar == ']')
+	{
+		auto arrayValue = std::make_unique<Values::ArrayValue>();
+		auto parseResult = arrayValue->Parse(value);
+		if (!IsResultOk(parseResult))
+			RETURN_NULLPTR_WITH_RESULT(parseResult);
+
+		return arrayValue;
+	}
+	else
+	{
+		auto intValue = std::make_unique<Values::IntValue>();
+		auto parseResult = intValue->Parse(value);
+		if (!IsResultOk(parseResult))
+			RETURN_NULLPTR_WITH_RESULT(parseResult);
+
+		return intValue;
+	}
+}
+
+#if MINIPP_ENABLE_VALUE_POOL || MINIPP_USE_PMR
+#pragma region Node Allocation
+
+namespace minipp
+{
+	namespace detail
+	{
+		// stored in front of every heap allocated Value (and Section with MINIPP_USE_PMR), so delete finds its way back
+		struct NodeHeader
+		{
+#if MINIPP_ENABLE_VALUE_POOL
+			MiniPPFile::ValuePool* pool;
+#endif
+#if MINIPP_USE_PMR
+			std::pmr::memory_resource* resource;
+#endif
+		};
+
+		// keeps the object itself max-aligned
+		constexpr size_t NodeHeaderSize = (sizeof(NodeHeader) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+#if MINIPP_ENABLE_VALUE_POOL
+		static thread_local MiniPPFile::ValuePool* t_currentValuePool = nullptr;
+#endif
+#if MINIPP_USE_PMR
+		static thread_local std::pmr::memory_resource* t_currentMemoryResource = nullptr;
+#endif
+
+		inline void* AllocateBlock(size_t size)
+		{
+#if MINIPP_USE_PMR
+			return GetMemoryResource()->allocate(size, alignof(std::max_align_t));
+#else
+			return ::operator new(size);
+#endif
+		}
+
+		inline void DeallocateBlock(const NodeHeader* header, void* block, size_t size) noexcept
+		{
+#if MINIPP_USE_PMR
+			header->resource->deallocate(block, size, alignof(std::max_align_t));
+#else
+			(void)header;
+			(void)size;
+			::operator delete(block);
+#endif
+		}
+	}
+}
+
+#if MINIPP_USE_PMR
+std::pmr::memory_resource* minipp::detail::GetMemoryResource() noexcept
+{
+	return t_currentMemoryResource != nullptr ? t_currentMemoryResource : std::pmr::get_default_resource();
+}
+
+minipp::MiniPPFile::ResourceScope::ResourceScope(std::pmr::memory_resource* resource) noexcept
+	: m_previous(detail::t_currentMemoryResource)
+{
+	detail::t_currentMemoryResource = resource;
+}
+
+minipp::MiniPPFile::ResourceScope::~ResourceScope()
+{
+	detail::t_currentMemoryResource = m_previous;
+}
+
+void* minipp::MiniPPFile::Section::operator new(size_t size)
+{
+	size_t blockSize = size + detail::NodeHeaderSize;
+	void* block = detail::AllocateBlock(blockSize);
+	detail::NodeHeader* header = new (block) detail::NodeHeader();
+	header->resource = detail::GetMemoryResource();
+	return static_cast<char*>(block) + detail::NodeHeaderSize;
+}
+
+void minipp::MiniPPFile::Section::operator delete(void* ptr, size_t size) noexcept
+{
+	if (ptr == nullptr)
+		return;
+
+	void* block = static_cast<char*>(ptr) - detail::NodeHeaderSize;
+	detail::DeallocateBlock(static_cast<detail::NodeHeader*>(block), block, size + detail::NodeHeaderSize);
+}
+#endif
+
+namespace minipp
+{
+	namespace detail
+	{
+		// Value::operator new / delete only forward here, so the compiler always sees the pool or block allocation
+		// and its matching release together (and never a class operator new paired with the global delete).
+		inline void* AllocateValueNode(size_t size)
+		{
+			size_t blockSize = size + NodeHeaderSize;
+#if MINIPP_ENABLE_VALUE_POOL
+			MiniPPFile::ValuePool* pool = MiniPPFile::ValuePool::GetCurrent();
+			void* block = pool != nullptr ? pool->Allocate(blockSize) : AllocateBlock(blockSize);
+			NodeHeader* header = new (block) NodeHeader();
+			header->pool = pool;
+#else
+			void* block = AllocateBlock(blockSize);
+			NodeHeader* header = new (block) NodeHeader();
+#endif
+#if MINIPP_USE_PMR
+			header->resource = GetMemoryResource();
+#endif
+			return static_cast<char*>(block) + NodeHeaderSize;
+		}
+
+		inline void DeallocateValueNode(void* ptr, size_t size) noexcept
+		{
+			if (ptr == nullptr)
+				return;
+
+			void* block = static_cast<char*>(ptr) - NodeHeaderSize;
+			NodeHeader* header = static_cast<NodeHeader*>(block);
+#if MINIPP_ENABLE_VALUE_POOL
+			if (header->pool != nullptr)
+			{
+				header->pool->Deallocate(block, size + NodeHeaderSize);
+				return;
+			}
+#endif
+			DeallocateBlock(header, block, size + NodeHeaderSize);
+		}
+	}
+}
+
+void* minipp::MiniPPFile::Value::operator new(size_t size)
+{
+	return detail::AllocateValueNode(size);
+}
+
+void minipp::MiniPPFile::Value::operator delete(void* ptr, size_t size) noexcept
+{
+	detail::DeallocateValueNode(ptr, size);
+}
+
+#pragma endregion
+#endif
+
+#if MINIPP_ENABLE_VALUE_POOL
+#pragma region Value Pool
+
+minipp::MiniPPFile::ValuePool::Scope::Scope(ValuePool* pool) noexcept
+	: m_previous(detail::t_currentValuePool)
+{
+	detail::t_currentValuePool = pool;
+}
+
+minipp::MiniPPFile::ValuePool::Scope::~Scope()
+{
+	detail::t_currentValuePool = m_previous;
+}
+
+minipp::MiniPPFile::ValuePool* minipp::MiniPPFile::ValuePool::GetCurrent() noexcept
+{
+	return detail::t_currentValuePool;
+}
+
+minipp::MiniPPFile::ValuePool::~ValuePool()
+{
+	for (auto slab : m_slabs)
+		FreeBlock(slab, SlabSize);
+}
+
+void* minipp::MiniPPFile::ValuePool::AllocateBlock(size_t size)
+{
+#if MINIPP_USE_PMR
+	return m_resource->allocate(size, alignof(std::max_align_t));
+#else
+	return ::operator new(size);
+#endif
+}
+
+void minipp::MiniPPFile::ValuePool::FreeBlock(void* block, size_t size) noexcept
+{
+#if MINIPP_USE_PMR
+	m_resource->deallocate(block, size, alignof(std::max_align_t));
+#else
+	(void)size;
+	::operator delete(block);
+#endif
+}
+
+void minipp::MiniPPFile::ValuePool::Release() noexcept
+{
+	// values that outlive the owning file (moved out of the tree) keep the pool alive until they are gone
+	m_released = true;
+	if (m_liveCount == 0)
+		delete this;
+}
+
+void* minipp::MiniPPFile::ValuePool::Allocate(size_t size)
+{
+	// m_liveCount only counts allocations that succeeded, otherwise Release could never delete the pool
+	size_t sizeClass = (size + Granularity - 1) / Granularity;
+	if (sizeClass > ClassCount)
+	{
+		void* block = AllocateBlock(size);
+		++m_liveCount;
+		return block;
+	}
+
+	FreeNode*& freeList = m_freeLists[sizeClass - 1];
+	if (freeList != nullptr)
+	{
+		FreeNode* node = freeList;
+		freeList = node->next;
+		++m_recycledCount;
+		++m_liveCount;
+		return node;
+	}
+
+	size_t chunkSize = sizeClass * Granularity;
+	if (static_cast<size_t>(m_slabEnd - m_slabCursor) < chunkSize)
+	{
+		m_slabs.reserve(m_slabs.size() + 1);
+		m_slabCursor = static_cast<char*>(AllocateBlock(SlabSize));
+		m_slabEnd = m_slabCursor + SlabSize;
+		m_slabs.push_back(m_slabCursor);
+	}
+
+	void* chunk = m_slabCursor;
+	m_slabCursor += chunkSize;
+	++m_liveCount;
+	return chunk;
+}
+
+void minipp::MiniPPFile::ValuePool::Deallocate(void* block, size_t size) noexcept
+{
+	size_t sizeClass = (size + Granularity - 1) / Granularity;
+	if (sizeClass > ClassCount)
+		FreeBlock(block, size);
+	else
+	{
+		FreeNode* node = static_cast<FreeNode*>(block);
+		node->next = m_freeLists[sizeClass - 1];
+		m_freeLists[sizeClass - 1] = node;
+	}
+
+	if (--m_liveCount == 0 && m_released)
+		delete this;
+}
+
+#pragma endregion
+#endif
+
+#pragma region Value Types
+
+minipp::EResult minipp::MiniPPFile::Values::StringValue::Parse(const String& str) noexcept
+{
+	static const char specialChars[] = { '\\', '"' };
+
+	m_value.clear();
+	m_value.reserve(str.size());
+
+	size_t i = 0;
+	while (i < str.size())
+	{
+		// plain runs are copied in one go, only escapes and quotes need a closer look
+		size_t next = i + Tools::FindFirstOf(str.data() + i, str.size() - i, specialChars, sizeof(specialChars));
+		m_value.append(str, i, next - i);
+		if (next == str.size())
+			break;
+		i = next;
+
+		if (str[i] == '"')
+			return EResult::UnescapedStringValue;
+
+		if (i + 1 >= str.size())
+		{
+			PP_COUT_SYNTAX_ERROR("'\\' at end of string");
+			return EResult::BadEscapeSequence;
+		}
+
+		switch (str[i + 1])
+		{
+		case '\"':
+			m_value.push_back('\"');
+			break;
+		case 'n':
+			m_value.push_back('\n');
+			break;
+		case 't':
+			m_value.push_back('\t');
+			break;
+		case 'r':
+			m_value.push_back('\r');
+			break;
+		case '\\':
+			m_value.push_back('\\');
+			break;
+		default:
+			PP_COUT_SYNTAX_ERROR("Unknown escape sequence '\\" << str[i + 1] << "'");
+			return EResult::UnknownEscapeSequence;
+		}
+		i += 2;
+	}
+
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::Values::StringValue::ToString(String& destination) const noexcept
+{
+	destination.clear();
+	Tools::AppendEscapedString(destination, m_value.data(), m_value.size());
+	return EResult::Success;
+}
+
+
+minipp::EResult minipp::MiniPPFile::Values::IntValue::Parse(const String& str) noexcept
+{
+	String sanitizedValue = str;
+	Tools::RemoveAll(sanitizedValue, '_');
+	if (sanitizedValue.empty())
+	{
+		PP_COUT_SYNTAX_ERROR("Empty string for integer value.");
+		return EResult::FormatError;
+	}
+
+	char lastCharacter = str.back();
+	auto rest = str.substr(0, str.size() - 1);
+	try
+	{
+		if (lastCharacter == 'h')
+		{
+			m_value = std::stoll(detail::ToStdString(rest), nullptr, 16);
+			m_style = EIntStyle::Hexadecimal;
+		}
+		else if (lastCharacter == 'b')
+		{
+			m_value = std::stoll(detail::ToStdString(rest), nullptr, 2);
+			m_style = EIntStyle::Binary;
+		}
+		else
+		{
+			if (!Tools::IsIntegerDecimal(sanitizedValue))
+			{
+				PP_COUT_SYNTAX_ERROR("Invalid decimal integer value: " << sanitizedValue);
+				return EResult::IntegerValueInvalid;
+			}
+			m_value = std::stoll(detail::ToStdString(sanitizedValue));
+			m_style = EIntStyle::Decimal;
+		}
+	}
+	catch (const std::invalid_argument&)
+	{
+		PP_COUT_SYNTAX_ERROR("Invalid integer value: " << sanitizedValue);
+		return EResult::IntegerValueInvalid;
+	}
+	catch (const std::out_of_range&)
+	{
+		PP_COUT_SYNTAX_ERROR("Integer value out of range: " << sanitizedValue);
+		return EResult::IntegerValueOutOfRange;
+	}
+
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::Values::IntValue::ToString(String& destination) const noexcept
+{
+	destination.clear();
+	return Tools::AppendInt(destination, m_value, m_style);
+}
+
+minipp::EResult minipp::MiniPPFile::Values::BooleanValue::Parse(const String& str) noexcept
+{
+	if (str == "true")
+		m_value = true;
+	else if (str == "false")
+		m_value = false;
+	else
+	{
+		PP_COUT_SYNTAX_ERROR("Invalid boolean value: " << str << " (may only contain lowercase true and false)");
+		return EResult::BooleanValueInvalid;
+	}
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::Values::BooleanValue::ToString(String& destination) const noexcept
+{
+	destination = m_value ? "true" : "false";
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::Values::FloatValue::Parse(const String& str) noexcept
+{
+	try
+	{
+		m_value = std::stod(detail::ToStdString(str));
+	}
+	catch (...)
+	{
+		PP_COUT_SYNTAX_ERROR("Invalid float value: " << str);
+		return EResult::FloatValueInvalid;
+	}
+
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::Values::FloatValue::ToString(String& destination) const noexcept
+{
+	destination.clear();
+	Tools::AppendFloat(destination, m_value);
+	return EResult::Success;
+}
+
+size_t minipp::MiniPPFile::Value::MeasureSerializedSize() const noexcept
+{
+	String buffer;
+	return IsResultOk(ToString(buffer)) ? buffer.size() : 0;
+}
+
+size_t minipp::MiniPPFile::Values::StringValue::MeasureSerializedSize() const noexcept
+{
+	return Tools::MeasureEscapedString(m_value.data(), m_value.size());
+}
+
+size_t minipp::MiniPPFile::Values::IntValue::MeasureSerializedSize() const noexcept
+{
+	return Tools::MeasureInt(m_value, m_style);
+}
+
+size_t minipp::MiniPPFile::Values::BooleanValue::MeasureSerializedSize() const noexcept
+{
+	return m_value ? 4 : 5;
+}
+
+size_t minipp::MiniPPFile::Values::FloatValue::MeasureSerializedSize() const noexcept
+{
+	return Tools::MeasureFloat(m_value);
+}
+
+minipp::EResult minipp::MiniPPFile::Value::AppendJson(String& destination) const noexcept
+{
+	String buffer;
+	auto result = ToString(buffer);
+	if (IsResultOk(result))
+		Tools::AppendJsonString(destination, buffer.data(), buffer.size());
+	return result;
+}
+
+minipp::EResult minipp::MiniPPFile::Values::StringValue::AppendJson(String& destination) const noexcept
+{
+	Tools::AppendJsonString(destination, m_value.data(), m_value.size());
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::Values::IntValue::AppendJson(String& destination) const noexcept
+{
+	return Tools::AppendInt(destination, m_value, EIntStyle::Decimal);
+}
+
+minipp::EResult minipp::MiniPPFile::Values::BooleanValue::AppendJson(String& destination) const noexcept
+{
+	destination += m_value ? "true" : "false";
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::Values::FloatValue::AppendJson(String& destination) const noexcept
+{
+	Tools::AppendJsonFloat(destination, m_value);
+	return EResult::Success;
+}
+
+minipp::MiniPPFile::Values::ArrayValue::ArrayValue(ArrayValue&& other) noexcept
+	: Value(std::move(other)),
+	m_values(std::move(other.m_values)),
+	m_storage(other.m_storage),
+	m_packedInts(std::move(other.m_packedInts)),
+	m_packedFloats(std::move(other.m_packedFloats)),
+	m_packedBits(std::move(other.m_packedBits)),
+	m_packedBitCount(other.m_packedBitCount),
+	m_lazySource(std::move(other.m_lazySource)),
+	m_lazyOffsets(std::move(other.m_lazyOffsets)),
+	m_lazyElements(std::move(other.m_lazyElements)),
+	m_lazyElementType(other.m_lazyElementType)
+{
+	// the moved-from containers are only guaranteed to be valid, not empty
+	other.m_values.clear();
+	other.m_lazyElements.clear();
+	other.ClearStorage();
+}
+
+minipp::MiniPPFile::Values::ArrayValue& minipp::MiniPPFile::Values::ArrayValue::operator=(ArrayValue&& other) noexcept
+{
+	if (this != &other)
+	{
+		ClearStorage();
+		m_comments.clear();
+		Swap(other);
+	}
+	return *this;
+}
+
+minipp::MiniPPFile::Values::ArrayValue::~ArrayValue()
+{
+	for (auto& val : m_values)
+		delete val;
+	for (auto& pair : m_lazyElements)
+		delete pair.second;
+}
+
+void minipp::MiniPPFile::Values::ArrayValue::Swap(ArrayValue& other) noexcept
+{
+	detail::SwapStorage(m_comments, other.m_comments);
+	detail::SwapStorage(m_values, other.m_values);
+	std::swap(m_storage, other.m_storage);
+	detail::SwapStorage(m_packedInts, other.m_packedInts);
+	detail::SwapStorage(m_packedFloats, other.m_packedFloats);
+	detail::SwapStorage(m_packedBits, other.m_packedBits);
+	std::swap(m_packedBitCount, other.m_packedBitCount);
+	detail::SwapStorage(m_lazySource, other.m_lazySource);
+	detail::SwapStorage(m_lazyOffsets, other.m_lazyOffsets);
+	detail::SwapStorage(m_lazyElements, other.m_lazyElements);
+	std::swap(m_lazyElementType, other.m_lazyElementType);
+}
+
+void minipp::MiniPPFile::Values::ArrayValue::ClearStorage() noexcept
+{
+	for (auto& val : m_values)
+		delete val;
+	for (auto& pair : m_lazyElements)
+		delete pair.second;
+	m_values.clear();
+	m_lazyElements.clear();
+	m_packedInts.clear();
+	m_packedFloats.clear();
+	m_packedBits.clear();
+	m_packedBitCount = 0;
+	m_lazySource.clear();
+	m_lazyOffsets.clear();
+	m_storage = EStorage::Boxed;
+}
+
+size_t minipp::MiniPPFile::Values::ArrayValue::GetSize() const noexcept
+{
+	switch (m_storage)
+	{
+	case EStorage::PackedInt:
+		return m_packedInts.size();
+	case EStorage::PackedFloat:
+		return m_packedFloats.size();
+	case EStorage::PackedBool:
+		return m_packedBitCount;
+	case EStorage::Lazy:
+		return m_lazyOffsets.empty() ? 0 : m_lazyOffsets.size() - 1;
+	default:
+		return m_values.size();
+	}
+}
+
+minipp::EResult minipp::MiniPPFile::Values::ArrayValue::GetElementType(EValueType* destination) const noexcept
+{
+	switch (m_storage)
+	{
+	case EStorage::PackedInt:
+		*destination = EValueType::Int;
+		break;
+	case EStorage::PackedFloat:
+		*destination = EValueType::Float;
+		break;
+	case EStorage::PackedBool:
+		*destination = EValueType::Boolean;
+		break;
+	case EStorage::Lazy:
+		if (GetSize() == 0)
+			return EResult::ValueEmpty;
+		*destination = m_lazyElementType;
+		break;
+	default:
+		if (m_values.empty())
+			return EResult::ValueEmpty;
+		*destination = m_values.front()->GetType();
+		break;
+	}
+
+	return EResult::Success;
+}
+
+template<typename ValueDataType, typename TargetType>
+minipp::EResult minipp::MiniPPFile::Values::ArrayValue::CopyBoxedTo(TargetType* destination, size_t count) const noexcept
+{
+	if (count > GetSize())
+		return EResult::IndexOutOfRange;
+	if (count == 0)
+		return EResult::Success;
+
+	EValueType elementType;
+	GetElementType(&elementType);
+	if (elementType != ValueDataType::Type)
+		return EResult::InvalidDataType;
+
+	// the type tag check only guards against arrays made inconsistent through GetValue()
+	std::unique_ptr<Value> parsedElement;
+	EResult result = EResult::Success;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Value* element = GetElement(i, parsedElement, &result);
+		if (element == nullptr)
+			return result;
+		if (element->GetType() != ValueDataType::Type)
+			return EResult::ArrayDataTypeInconsistency;
+		destination[i] = static_cast<TargetType>(static_cast<const ValueDataType*>(element)->GetValue());
+	}
+
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::Values::ArrayValue::CopyTo(int64_t* destination, size_t count) const noexcept
+{
+	if (m_storage == EStorage::PackedInt && count <= m_packedInts.size())
+	{
+		std::copy_n(m_packedInts.data(), count, destination);
+		return EResult::Success;
+	}
+	return CopyBoxedTo<IntValue>(destination, count);
+}
+
+minipp::EResult minipp::MiniPPFile::Values::ArrayValue::CopyTo(double* destination, size_t count) const noexcept
+{
+	if (m_storage == EStorage::PackedFloat && count <= m_packedFloats.size())
+	{
+		std::copy_n(m_packedFloats.data(), count, destination);
+		return EResult::Success;
+	}
+	return CopyBoxedTo<FloatValue>(destination, count);
+}
+
+minipp::EResult minipp::MiniPPFile::Values::ArrayValue::CopyTo(float* destination, size_t count) const noexcept
+{
+	if (m_storage == EStorage::PackedFloat && count <= m_packedFloats.size())
+	{
+		for (size_t i = 0; i < count; ++i)
+			destination[i] = static_cast<float>(m_packedFloats[i]);
+		return EResult::Success;
+	}
+	return CopyBoxedTo<FloatValue>(destination, count);
+}
+
+minipp::EResult minipp::MiniPPFile::Values::ArrayValue::CopyTo(bool* destination, size_t count) const noexcept
+{
+	if (m_storage == EStorage::PackedBool && count <= m_packedBitCount)
+	{
+		for (size_t i = 0; i < count; ++i)
+			destination[i] = ((m_packedBits[i / 64] >> (i % 64)) & 1) != 0;
+		return EResult::Success;
+	}
+	return CopyBoxedTo<BooleanValue>(destination, count);
+}
+
+minipp::EResult minipp::MiniPPFile::Values::ArrayValue::CopyTo(String* destination, size_t count) const noexcept
+{
+	return CopyBoxedTo<StringValue>(destination, count);
+}
+
+size_t minipp::MiniPPFile::Values::ArrayValue::GetFlatSize() const noexcept
+{
+	EValueType elementType;
+	if (IsPacked() || GetElementType(&elementType) != EResult::Success || elementType != EValueType::Array)
+		return GetSize();
+
+	size_t size = 0;
+	std::unique_ptr<Value> parsedElement;
+	for (size_t i = 0; i < GetSize(); ++i)
+	{
+		const Value* element = GetElement(i, parsedElement, nullptr);
+		if (element == nullptr)
+			continue;
+		size += element->GetType() == EValueType::Array ? static_cast<const ArrayValue*>(element)->GetFlatSize() : 1;
+	}
+	return size;
+}
+
+template<typename TargetType>
+minipp::EResult minipp::MiniPPFile::Values::ArrayValue::CopyFlatTo(TargetType* destination, size_t capacity, size_t& written) const noexcept
+{
+	EValueType elementType;
+	if (GetElementType(&elementType) != EResult::Success)
+		return EResult::Success; // nothing to copy
+
+	if (elementType == EValueType::Array)
+	{
+		std::unique_ptr<Value> parsedElement;
+		EResult result = EResult::Success;
+		for (size_t i = 0; i < GetSize(); ++i)
+		{
+			const Value* element = GetElement(i, parsedElement, &result);
+			if (element == nullptr)
+				return result;
+			if (element->GetType() != EValueType::Array)
+				return EResult::ArrayDataTypeInconsistency;
+			result = static_cast<const ArrayValue*>(element)->CopyFlatTo(destination, capacity, written);
+			if (!IsResultOk(result))
+				return result;
+		}
+		return EResult::Success;
+	}
+
+	size_t size = GetSize();
+	if (capacity - written < size)
+		return EResult::BufferTooSmall;
+
+	auto result = CopyTo(destination + written, size);
+	if (IsResultOk(result))
+		written += size;
+	return result;
+}
+
+minipp::EResult minipp::MiniPPFile::Values::ArrayValue::CopyFlatTo(int64_t* destination, size_t capacity, size_t* written) const noexcept
+{
+	size_t count = 0;
+	auto result = CopyFlatTo(destination, capacity, count);
+	if (written != nullptr)
+		*written = count;
+	return result;
+}
+
+minipp::EResult minipp::MiniPPFile::Values::ArrayValue::CopyFlatTo(double* destination, size_t capacity, size_t* written) const noexcept
+{
+	size_t count = 0;
+	auto result = CopyFlatTo(destination, capacity, count);
+	if (written != nullptr)
+		*written = count;
+	return result;
+}
+
+minipp::EResult minipp::MiniPPFile::Values::ArrayValue::CopyFlatTo(float* destination, size_t capacity, size_t* written) const noexcept
+{
+	size_t count = 0;
+	auto result = CopyFlatTo(destination, capacity, count);
+	if (written != nullptr)
+		*written = count;
+	return result;
+}
+
+minipp::EResult minipp::MiniPPFile::Values::ArrayValue::CopyFlatTo(bool* destination, size_t capacity, size_t* written) const noexcept
+{
+	size_t count = 0;
+	auto result = CopyFlatTo(destination, capacity, count);
+	if (written != nullptr)
+		*written = count;
+	return result;
+}
+
+minipp::EResult minipp::MiniPPFile::Values::ArrayValue::CopyFlatTo(String* destination, size_t capacity, size_t* written) const noexcept
+{
+	size_t count = 0;
+	auto result = CopyFlatTo(destination, capacity, count);
+	if (written != nullptr)
+		*written = count;
+	return result;
+}
+
+void minipp::MiniPPFile::Values::ArrayValue::AssignBits(const uint64_t* words, size_t bitCount)
+{
+	// drops lazily parsed text and elements too, not just the boxed ones
+	ClearStorage();
+	detail::ReleaseStorage(m_packedInts);
+	detail::ReleaseStorage(m_packedFloats);
+
+	m_packedBits.assign(words, words + (bitCount + 63) / 64);
+	if (bitCount % 64 != 0)
+		m_packedBits.back() &= (uint64_t(1) << (bitCount % 64)) - 1;
+	m_packedBitCount = bitCount;
+	m_storage = EStorage::PackedBool;
+}
+
+bool minipp::MiniPPFile::Values::ArrayValue::TestBit(size_t index) const noexcept
+{
+	if (m_storage == EStorage::PackedBool)
+		return index < m_packedBitCount && ((m_packedBits[index / 64] >> (index % 64)) & 1) != 0;
+
+	auto boolValue = dynamic_cast<const BooleanValue*>((*this)[index]);
+	return boolValue != nullptr && boolValue->GetValue();
+}
+
+size_t minipp::MiniPPFile::Values::ArrayValue::CountSetBits() const noexcept
+{
+	size_t count = 0;
+	if (m_storage == EStorage::PackedBool)
+	{
+		for (const auto word : m_packedBits)
+			count += std::bitset<64>(word).count();
+		return count;
+	}
+
+	for (size_t i = 0; i < GetSize(); ++i)
+		if (TestBit(i))
+			++count;
+	return count;
+}
+
+void minipp::MiniPPFile::Values::ArrayValue::Unpack() const
+{
+#if MINIPP_USE_PMR
+	// boxing may happen long after Parse, the elements still belong to the array's resource
+	ResourceScope resourceScope(m_values.get_allocator().resource());
+#endif
+	// if boxing throws, the elements boxed so far are dropped again and the array keeps its storage
+	// (lazy elements only move over from the cache once nothing can throw anymore)
+	size_t boxedBefore = m_values.size();
+	try
+	{
+		switch (m_storage)
+		{
+		case EStorage::PackedInt:
+			m_values.reserve(m_values.size() + m_packedInts.size());
+			for (const auto value : m_packedInts)
+				m_values.push_back(new IntValue(value));
+			detail::ReleaseStorage(m_packedInts);
+			break;
+		case EStorage::PackedFloat:
+			m_values.reserve(m_values.size() + m_packedFloats.size());
+			for (const auto value : m_packedFloats)
+				m_values.push_back(new FloatValue(value));
+			detail::ReleaseStorage(m_packedFloats);
+			break;
+		case EStorage::PackedBool:
+			m_values.reserve(m_values.size() + m_packedBitCount);
+			for (size_t i = 0; i < m_packedBitCount; ++i)
+				m_values.push_back(new BooleanValue(((m_packedBits[i / 64] >> (i % 64)) & 1) != 0));
+			detail::ReleaseStorage(m_packedBits);
+			m_packedBitCount = 0;
+			break;
+		case EStorage::Lazy:
+		{
+			// all elements go through the cache first, so a failure leaves the array lazy instead of dropping elements
+			// (ParseLazy already validated them, this is only a safety net)
+			size_t count = GetSize();
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (m_lazyElements.find(i) != m_lazyElements.end())
+					continue;
+
+				EResult result;
+				auto parsed = ParseLazyElement(i, &result);
+				if (parsed == nullptr)
+				{
+					PP_COUT_SYNTAX_ERROR("Failed to parse lazy array element " << i);
+					return;
+				}
+				auto& slot = m_lazyElements[i];
+				slot = parsed.release();
+			}
+
+			m_values.reserve(m_values.size() + count);
+			for (size_t i = 0; i < count; ++i)
+				m_values.push_back(m_lazyElements.find(i)->second);
+			m_lazyElements.clear();
+			detail::ReleaseStorage(m_lazySource);
+			detail::ReleaseStorage(m_lazyOffsets);
+			break;
+		}
+		default: break;
+		}
+	}
+	catch (...)
+	{
+		for (size_t i = boxedBefore; i < m_values.size(); ++i)
+			delete m_values[i];
+		m_values.resize(boxedBefore);
+		throw;
+	}
+
+	m_storage = EStorage::Boxed;
+}
+
+minipp::String minipp::MiniPPFile::Values::ArrayValue::GetLazyElementText(size_t index) const
+{
+	// Rebuilds the element exactly like the tokenizer in Parse would: whitespace outside of strings is dropped.
+	size_t begin = m_lazyOffsets[index];
+	size_t end = m_lazyOffsets[index + 1] - 1;
+
+	String element;
+	element.reserve(end - begin);
+	bool isInString = false;
+	for (size_t i = begin; i < end; ++i)
+	{
+		char c = m_lazySource[i];
+		if (isInString)
+		{
+			if (c == '\\' && i + 1 < end)
+				element += m_lazySource[i++];
+			else if (c == '"')
+				isInString = false;
+			element += m_lazySource[i];
+		}
+		else if (c == '\\')
+			++i;
+		else if (c == '"')
+		{
+			isInString = true;
+			element += c;
+		}
+		else if (c != ' ' && c != '\t')
+			element += c;
+	}
+
+	return element;
+}
+
+std::unique_ptr<minipp::MiniPPFile::Value> minipp::MiniPPFile::Values::ArrayValue::ParseLazyElement(size_t index, EResult* result) const
+{
+#if MINIPP_USE_PMR
+	// same as Unpack, the element is allocated next to the array
+	ResourceScope resourceScope(m_values.get_allocator().resource());
+#endif
+	return ParseValue(GetLazyElementText(index), result);
+}
+
+minipp::EResult minipp::MiniPPFile::Values::ArrayValue::ValidateElement(const String& element, EValueType* type) noexcept
+{
+	// Same dispatch and checks as ParseValue, but into values on the stack, so nothing gets boxed.
+	// Nested arrays are validated by indexing them lazily as well.
+	if (element.empty())
+	{
+		PP_COUT_SYNTAX_ERROR("Empty array element.");
+		return EResult::FormatError;
+	}
+
+	char lastChar = element.back();
+	if (element.front() == '"')
+	{
+		*type = EValueType::String;
+		if (lastChar != '"' || element.size() < 2)
+			return EResult::MissingQuote;
+		StringValue value;
+		return value.Parse(element.substr(1, element.size() - 2));
+	}
+	if (lastChar == 'e')
+	{
+		*type = EValueType::Boolean;
+		BooleanValue value;
+		return value.Parse(element);
+	}
+	if (lastChar == 'f')
+	{
+		*type = EValueType::Float;
+		FloatValue value;
+		return value.Parse(element);
+	}
+	if (lastChar == ']')
+	{
+		*type = EValueType::Array;
+		ArrayValue value;
+		return value.ParseLazy(element);
+	}
+
+	*type = EValueType::Int;
+	IntValue value;
+	return value.Parse(element);
+}
+
+const minipp::MiniPPFile::Value* minipp::MiniPPFile::Values::ArrayValue::GetLazyElement(size_t index) const noexcept
+{
+	if (index >= GetSize())
+		return nullptr;
+
+	auto it = m_lazyElements.find(index);
+	if (it != m_lazyElements.end())
+		return it->second;
+
+	try
+	{
+		EResult result;
+		auto parsed = ParseLazyElement(index, &result);
+		if (parsed == nullptr)
+			return nullptr;
+
+		// the slot first, so a failing insert doesn't leak the element
+		auto& slot = m_lazyElements[index];
+		slot = parsed.release();
+		return slot;
+	}
+	catch (...)
+	{
+		PP_COUT("Out of memory while parsing lazy array element " << index);
+		return nullptr;
+	}
+}
+
+const minipp::MiniPPFile::Value* minipp::MiniPPFile::Values::ArrayValue::GetElement(size_t index, std::unique_ptr<Value>& parsedElement, EResult* result) const
+{
+	// For read-only walks over lazy arrays: uncached elements are parsed into parsedElement instead of the cache
+	if (m_storage == EStorage::Lazy)
+	{
+		auto it = m_lazyElements.find(index);
+		if (it != m_lazyElements.end())
+			return it->second;
+
+		parsedElement = ParseLazyElement(index, result);
+		return parsedElement.get();
+	}
+
+	return GetValue()[index];
+}
+
+minipp::EResult minipp::MiniPPFile::Values::ArrayValue::ParseLazy(String str) noexcept
+{
+	if (str.size() < 2 || str.front() != '[' || str.back() != ']')
+	{
+		PP_COUT_SYNTAX_ERROR("Array value must be enclosed in [] brackets.");
+		return EResult::FormatError;
+	}
+	if (!m_values.empty() || m_storage != EStorage::Boxed || str.size() > UINT32_MAX)
+		return Parse(str);
+
+	static const char stringSpecialChars[] = { '\\', '"' };
+	static const char structuralChars[] = { '\\', '"', '[', ']', ',' };
+
+	Vector<uint32_t> offsets(m_lazyOffsets.get_allocator());
+
+	// only records where the element ends, the elements are validated once all of them are known
+	auto addElement = [&](size_t begin, size_t end, bool isLast) -> EResult
+	{
+		size_t first = begin;
+		size_t last = end;
+		while (first < last && (str[first] == ' ' || str[first] == '\t'))
+			++first;
+		while (last > first && (str[last - 1] == ' ' || str[last - 1] == '\t'))
+			--last;
+		if (first == last)
+		{
+			if (isLast) // a trailing ',' is fine
+				return EResult::Success;
+			PP_COUT_SYNTAX_ERROR("Empty array element.");
+			return EResult::FormatError;
+		}
+
+		if (offsets.empty())
+			offsets.push_back(static_cast<uint32_t>(begin));
+		offsets.push_back(static_cast<uint32_t>(end + 1));
+		return EResult::Success;
+	};
+
+	int64_t bracketCounter = 0;
+	bool isInString = false;
+	size_t elementBegin = 1;
+
+	for (size_t i = 0; i < str.size(); ++i)
+	{
+		i += isInString
+			? Tools::FindFirstOf(str.data() + i, str.size() - i, stringSpecialChars, sizeof(stringSpecialChars))
+			: Tools::FindFirstOf(str.data() + i, str.size() - i, structuralChars, sizeof(structuralChars));
+		if (i >= str.size())
+			break;
+
+		char c = str[i];
+		if (isInString)
+		{
+			if (c == '\\')
+			{
+				if (i + 1 >= str.size())
+				{
+					PP_COUT_SYNTAX_ERROR("Bad escape sequence: '\\' at end of string");
+					return EResult::BadEscapeSequence;
+				}
+				++i;
+			}
+			else if (c == '"')
+				isInString = false;
+		}
+		else if (c == '\\')
+			++i;
+		else if (c == '"')
+			isInString = true;
+		else if (c == '[')
+			++bracketCounter;
+		else if (c == ']')
+		{
+			if (--bracketCounter < 0)
+			{
+				PP_COUT_SYNTAX_ERROR("Array brackets are not balanced. (One ] too much or encountered too early)");
+				return EResult::ArrayBracketsInbalanced;
+			}
+			if (bracketCounter == 0 && i != str.size() - 1)
+				return Parse(str); // something like "[1][2]", leave it to the regular tokenizer
+		}
+		else if (c == ',' && bracketCounter == 1)
+		{
+			auto result = addElement(elementBegin, i, false);
+			if (!IsResultOk(result))
+				return result;
+			elementBegin = i + 1;
+		}
+	}
+
+	if (bracketCounter != 0)
+	{
+		PP_COUT_SYNTAX_ERROR("Array brackets are not balanced. (Missing " << bracketCounter << " closing brackets)");
+		return EResult::ArrayBracketsInbalanced;
+	}
+
+	auto result = addElement(elementBegin, str.size() - 1, true);
+	if (!IsResultOk(result))
+		return result;
+
+	m_lazySource = std::move(str);
+	m_lazyOffsets = std::move(offsets);
+
+	// checks every element as Parse would see it, mixed arrays included (ArrayDataTypeInconsistency)
+	EValueType elementType = EValueType::Int;
+	size_t count = m_lazyOffsets.empty() ? 0 : m_lazyOffsets.size() - 1;
+	for (size_t i = 0; i < count; ++i)
+	{
+		EValueType type = EValueType::Int;
+		result = ValidateElement(GetLazyElementText(i), &type);
+		if (IsResultOk(result) && i != 0 && type != elementType)
+			result = EResult::ArrayDataTypeInconsistency;
+		if (!IsResultOk(result))
+		{
+			ClearStorage();
+			return result;
+		}
+		elementType = type;
+	}
+
+	m_lazyElementType = elementType;
+	m_storage = EStorage::Lazy;
+	return EResult::Success;
+}
+
+bool minipp::MiniPPFile::Values::ArrayValue::TryParsePacked(const String& str) noexcept
+{
+	// Only flat arrays of plain decimal integers or floats are handled here. Anything unusual
+	// (underscores, nesting, overflow, empty elements, ...) is left to the generic path,
+	// which also takes care of reporting the proper error.
+	if (!m_values.empty() || m_storage != EStorage::Boxed)
+		return false;
+
+	const char* begin = str.data() + 1;
+	const char* end = str.data() + str.size() - 1;
+	size_t size = static_cast<size_t>(end - begin);
+
+	const char* first = begin;
+	while (first < end && (*first == ' ' || *first == '\t'))
+		++first;
+	if (first < end && (*first == 't' || *first == 'f'))
+		return TryParsePackedBooleans(begin, end);
+
+	auto numericClass = Tools::ClassifyNumeric(begin, size);
+	if (numericClass == Tools::ENumericClass::None)
+		return false;
+
+	size_t elementCount = static_cast<size_t>(std::count(begin, end, ',')) + 1;
+	const char* p = begin;
+
+	if (numericClass == Tools::ENumericClass::Integer)
+	{
+		constexpr uint64_t maxValue = static_cast<uint64_t>(INT64_MAX);
+		Vector<int64_t> values(m_packedInts.get_allocator());
+		values.reserve(elementCount);
+
+		while (true)
+		{
+			uint64_t value = 0;
+			bool hasDigits = false;
+			while (p < end)
+			{
+				uint64_t digits;
+				size_t digitCount = Tools::ParseDigits(p, static_cast<size_t>(end - p), &digits);
+				if (digitCount != 0)
+				{
+					if (value > (maxValue - digits) / detail::PowersOfTen[digitCount])
+						return false;
+					value = value * detail::PowersOfTen[digitCount] + digits;
+					hasDigits = true;
+					p += digitCount;
+					continue;
+				}
+
+				if (*p == ',')
+					break;
+				++p; // whitespace
+			}
+
+			if (!hasDigits)
+				return false;
+			values.push_back(static_cast<int64_t>(value));
+
+			if (p == end)
+				break;
+			++p; // ','
+		}
+
+		m_packedInts = std::move(values);
+		m_storage = EStorage::PackedInt;
+		return true;
+	}
+
+	Vector<double> values(m_packedFloats.get_allocator());
+	values.reserve(elementCount);
+
+	while (true)
+	{
+		char* parsedEnd = nullptr;
+		errno = 0;
+		double value = std::strtod(p, &parsedEnd);
+		if (parsedEnd == p || errno == ERANGE || parsedEnd >= end || *parsedEnd != 'f')
+			return false;
+
+		p = parsedEnd + 1;
+		while (p < end && (*p == ' ' || *p == '\t'))
+			++p;
+		if (p < end && *p != ',')
+			return false;
+		values.push_back(value);
+
+		if (p == end)
+			break;
+		++p; // ','
+	}
+
+	m_packedFloats = std::move(values);
+	m_storage = EStorage::PackedFloat;
+	return true;
+}
+
+bool minipp::MiniPPFile::Values::ArrayValue::TryParsePackedBooleans(const char* begin, const char* end) noexcept
+{
+	Vector<uint64_t> words(m_packedBits.get_allocator());
+	words.reserve((static_cast<size_t>(std::count(begin, end, ',')) + 64) / 64);
+	size_t bitCount = 0;
+
+	const char* p = begin;
+	while (true)
+	{
+		while (p < end && (*p == ' ' || *p == '\t'))
+			++p;
+
+		bool value;
+		if (end - p >= 4 && std::memcmp(p, "true", 4) == 0)
+		{
+			value = true;
+			p += 4;
+		}
+		else if (end - p >= 5 && std::memcmp(p, "false", 5) == 0)
+		{
+			value = false;
+			p += 5;
+		}
+		else
+			return false;
+
+		while (p < end && (*p == ' ' || *p == '\t'))
+			++p;
+		if (p < end && *p != ',')
+			return false;
+
+		if (bitCount % 64 == 0)
+			words.push_back(0);
+		if (value)
+			words.back() |= uint64_t(1) << (bitCount % 64);
+		++bitCount;
+
+		if (p == end)
+			break;
+		++p; // ','
+	}
+
+	m_packedBits = std::move(words);
+	m_packedBitCount = bitCount;
+	m_storage = EStorage::PackedBool;
+	return true;
+}
+
+minipp::EResult minipp::MiniPPFile::Values::ArrayValue::Parse(const String& str) noexcept
+{
+	if (str.front() != '[' || str.back() != ']')
+	{
+		PP_COUT_SYNTAX_ERROR("Array value must be enclosed in [] brackets.");
+		return EResult::FormatError;
+	}
+
+	if (TryParsePacked(str))
+		return EResult::Success;
+
+	static const char stringSpecialChars[] = { '\\', '"' };
+	static const char structuralChars[] = { '\\', '"', '[', ']', ',', ' ', '\t' };
+
+	int64_t bracketCounter = 0;
+	bool isInString = false; // we may encounter array value separators "," inside strings; we need to ignore those
+
+	Vector<String> elements;
+	String currentElement;
+
+	for (size_t i = 0; i < str.size(); ++i)
+	{
+		// everything up to the next character that needs handling below belongs to the current element
+		size_t run = isInString
+			? Tools::FindFirstOf(str.data() + i, str.size() - i, stringSpecialChars, sizeof(stringSpecialChars))
+			: Tools::FindFirstOf(str.data() + i, str.size() - i, structuralChars, sizeof(structuralChars));
+		if (run != 0)
+		{
+			currentElement.append(str, i, run);
+			i += run;
+			if (i >= str.size())
+				break;
+		}
+
+		char c = str[i];
+
+		if (isInString)
+		{
+			if (c == '\\')
+			{
+				if (i + 1 >= str.size())
+				{
+					PP_COUT_SYNTAX_ERROR("Bad escape sequence: '\\' at end of string");
+					return EResult::BadEscapeSequence;
+				}
+				currentElement += c;
+				currentElement += str[i + 1];
+				++i;
+			}
+			else if (c == '"')
+			{
+				isInString = false;
+				currentElement += c;
+			}
+			else
+				currentElement += c;
+		}
+		else if (c == '\\')
+			++i;
+		else if (c == '"')
+		{
+			currentElement += c;
+			isInString = true;
+		}
+		else
+		{
+			if (c == '[')
+			{
+				if (++bracketCounter > 1)
+					currentElement += c;
+			}
+			else if (c == ']')
+			{
+				--bracketCounter;
+				if (bracketCounter < 0)
+				{
+					PP_COUT_SYNTAX_ERROR("Array brackets are not balanced. (One ] too much or encountered too early)");
+					return EResult::ArrayBracketsInbalanced;
+				}
+				else if (bracketCounter >= 1)
+					currentElement += c;
+			}
+			else if (c == ',' && bracketCounter == 1)
+			{
+				elements.push_back(currentElement);
+				currentElement = "";
+			}
+			else if (c != ' ' && c != '\t')
+				currentElement += c;
+		}
+	}
+
+	if (bracketCounter != 0) // will always be a positive value because negative values are caught earlier
+	{
+		PP_COUT_SYNTAX_ERROR("Array brackets are not balanced. (Missing " << bracketCounter << " closing brackets)");
+		return EResult::ArrayBracketsInbalanced;
+	}
+
+	if (!currentElement.empty())
+		elements.push_back(currentElement);
+	size_t lastTypeIdHash = 0;
+	bool hasTypeHash = false;
+
+	EResult result;
+	for (auto& elem : elements)
+	{
+		auto parsed = ParseValue(elem, &result);
+		if (parsed == nullptr)
+			return result;
+
+		if (!hasTypeHash)
+		{
+			lastTypeIdHash = typeid(*parsed).hash_code();
+			hasTypeHash = true;
+		}
+		else if (typeid(*parsed).hash_code() != lastTypeIdHash)
+			return EResult::ArrayDataTypeInconsistency;
+
+		m_values.push_back(parsed.release());
+	}
+
+	return EResult::Success;
+}
+
+size_t minipp::MiniPPFile::Values::ArrayValue::MeasureSerializedSize() const noexcept
+{
+	size_t count = GetSize();
+	size_t size = 2 + (count != 0 ? (count - 1) * 2 : 0); // brackets and ", " separators
+
+	switch (m_storage)
+	{
+	case EStorage::PackedBool:
+	{
+		size_t setBits = CountSetBits();
+		return size + setBits * 4 + (count - setBits) * 5;
+	}
+	case EStorage::PackedInt:
+		for (const auto value : m_packedInts)
+			size += Tools::MeasureInt(value, EIntStyle::Decimal);
+		return size;
+	case EStorage::PackedFloat:
+		for (const auto value : m_packedFloats)
+			size += Tools::MeasureFloat(value);
+		return size;
+	default: break;
+	}
+
+	std::unique_ptr<Value> parsedElement;
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Value* val = GetElement(i, parsedElement, nullptr);
+		if (val != nullptr)
+			size += val->MeasureSerializedSize();
+	}
+	return size;
+}
+
+minipp::EResult minipp::MiniPPFile::Values::ArrayValue::AppendJson(String& destination) const noexcept
+{
+	destination += '[';
+	size_t count = GetSize();
+	std::unique_ptr<Value> parsedElement;
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (i != 0)
+			destination += ',';
+
+		switch (m_storage)
+		{
+		case EStorage::PackedBool:
+			destination += ((m_packedBits[i / 64] >> (i % 64)) & 1) != 0 ? "true" : "false";
+			break;
+		case EStorage::PackedInt:
+			Tools::AppendInt(destination, m_packedInts[i], EIntStyle::Decimal);
+			break;
+		case EStorage::PackedFloat:
+			Tools::AppendJsonFloat(destination, m_packedFloats[i]);
+			break;
+		default:
+		{
+			EResult result = EResult::Success;
+			const Value* val = GetElement(i, parsedElement, &result);
+			if (val == nullptr)
+				return result;
+			result = val->AppendJson(destination);
+			if (!IsResultOk(result))
+				return result;
+			break;
+		}
+		}
+	}
+	destination += ']';
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::Values::ArrayValue::ToString(String& destination) const noexcept
+{
+	if (m_storage == EStorage::PackedBool)
+	{
+		// written straight from the bit words
+		destination = "[";
+		destination.reserve(m_packedBitCount * 7 + 2);
+		for (size_t i = 0; i < m_packedBitCount; ++i)
+		{
+			if (i != 0)
+				destination += ", ";
+			destination += ((m_packedBits[i / 64] >> (i % 64)) & 1) != 0 ? "true" : "false";
+		}
+		destination += ']';
+		return EResult::Success;
+	}
+
+	if (m_storage == EStorage::PackedInt || m_storage == EStorage::PackedFloat)
+	{
+		// same output as boxed IntValue / FloatValue elements, without creating them first
+		destination = "[";
+		size_t count = GetSize();
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (i != 0)
+				destination += ", ";
+			if (m_storage == EStorage::PackedInt)
+				Tools::AppendInt(destination, m_packedInts[i], EIntStyle::Decimal);
+			else
+				Tools::AppendFloat(destination, m_packedFloats[i]);
+		}
+		destination += ']';
+		return EResult::Success;
+	}
+
+	String buf;
+	size_t lastTypeIdHash = 0;
+	bool hasTypeHash = false;
+
+	std::stringstream ss;
+	std::unique_ptr<Value> parsedElement;
+	for (size_t i = 0; i < GetSize(); ++i)
+	{
+		EResult result = EResult::Success;
+		const Value* val = GetElement(i, parsedElement, &result);
+		if (val == nullptr)
+			return result;
+
+		result = val->ToString(buf);
+		if (!IsResultOk(result))
+			return result;
+
+		if (!hasTypeHash)
+		{
+			lastTypeIdHash = typeid(*val).hash_code();
+			hasTypeHash = true;
+		}
+		else if (typeid(*val).hash_code() != lastTypeIdHash)
+			return EResult::ArrayDataTypeInconsistency;
+
+		ss << buf << ", ";
+	}
+	String valueString(ss.str());
+	if (!valueString.empty()) // remove the last ", " if there are any elements
+		valueString = valueString.substr(0, valueString.size() - 2);
+
+	destination = "[" + valueString + "]";
+
+	return EResult::Success;
+}
+
+#pragma endregion
+
+minipp::MiniPPFile::Section::~Section()
+{
+	for (auto& pair : m_values)
+		delete pair.second;
+	for (auto& pair : m_subSections)
+		delete pair.second;
+}
+
+minipp::MiniPPFile::Section::Section(Section&& other) noexcept
+	: m_values(std::move(other.m_values)),
+	m_subSections(std::move(other.m_subSections)),
+	m_comments(std::move(other.m_comments))
+{
+	// the moved-from maps are only guaranteed to be valid, not empty
+	other.m_values.clear();
+	other.m_subSections.clear();
+	other.m_comments.clear();
+}
+
+minipp::MiniPPFile::Section& minipp::MiniPPFile::Section::operator=(Section&& other) noexcept
+{
+	if (this != &other)
+	{
+		Clear();
+		Swap(other);
+	}
+	return *this;
+}
+
+void minipp::MiniPPFile::Section::Swap(Section& other) noexcept
+{
+	detail::SwapStorage(m_values, other.m_values);
+	detail::SwapStorage(m_subSections, other.m_subSections);
+	detail::SwapStorage(m_comments, other.m_comments);
+}
+
+void minipp::MiniPPFile::Section::Clear() noexcept
+{
+	for (auto& pair : m_values)
+		delete pair.second;
+	for (auto& pair : m_subSections)
+		delete pair.second;
+	m_values.clear();
+	m_subSections.clear();
+	m_comments.clear();
+}
+
+minipp::EResult minipp::MiniPPFile::Section::GetSubSection(const String& key, Section** destination) const noexcept
+{
+	auto pathIndex = key.find('.');
+	String thisKey = key;
+	String rest;
+	if (pathIndex != String::npos)
+	{
+		thisKey = key.substr(0, pathIndex);
+		rest = key.substr(pathIndex + 1);
+	}
+
+	auto it = m_subSections.find(thisKey);
+	if (it == m_subSections.end())
+		return EResult::SectionNotPresent;
+	if (rest.empty())
+	{
+		*destination = it->second;
+		return EResult::Success;
+	}
+
+	return it->second->GetSubSection(rest, destination);
+}
+
+minipp::EResult minipp::MiniPPFile::Section::SetSubSection(String name, std::unique_ptr<Section> value, bool allowOverwrite) noexcept
+{
+	auto inserted = m_subSections.emplace(std::move(name), value.get());
+	if (!inserted.second)
+	{
+		if (!allowOverwrite)
+			return EResult::SectionAlreadyPresent;
+		delete inserted.first->second;
+		inserted.first->second = value.get();
+	}
+
+	value.release();
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::Section::EmplaceSubSection(String name, Section** destination)
+{
+	auto inserted = m_subSections.emplace(std::move(name), nullptr);
+	if (inserted.second)
+	{
+		try
+		{
+			inserted.first->second = new Section();
+		}
+		catch (...)
+		{
+			m_subSections.erase(inserted.first);
+			throw;
+		}
+	}
+
+	if (destination != nullptr)
+		*destination = inserted.first->second;
+	return inserted.second ? EResult::Success : EResult::SectionAlreadyPresent;
+}
+
+void minipp::MiniPPFile::Section::Reserve(size_t valueCount, size_t subSectionCount)
+{
+	m_values.reserve(valueCount);
+	m_subSections.reserve(subSectionCount);
+}
+
+minipp::EResult minipp::MiniPPFile::SerializeValues(const Section* section, String& destination) noexcept
+{
+	if (section->m_values.empty())
+		return EResult::Success;
+
+	String valueString;
+	for (const auto& pair : section->m_values)
+	{
+		if (!Tools::IsNameValid(pair.first))
+		{
+			PP_COUT_SYNTAX_ERROR("Invalid name for key: " << pair.first);
+			return EResult::InvalidName;
+		}
+
+		for (const auto& comment : pair.second->m_comments)
+		{
+			destination += comment;
+			destination += '\n';
+		}
+
+		destination += pair.first;
+		destination += " = ";
+		auto result = pair.second->ToString(valueString);
+		if (!IsResultOk(result))
+			return result;
+		destination += valueString;
+		destination += '\n';
+	}
+	destination += '\n';
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::SerializeSection(const Section* section, String& destination, const String& path) noexcept
+{
+	auto result = SerializeValues(section, destination);
+	if (!IsResultOk(result))
+		return result;
+
+	for (const auto& pair : section->m_subSections)
+	{
+		result = SerializeSubSection(pair.first, pair.second, destination, path);
+		if (!IsResultOk(result))
+			return result;
+	}
+
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::SerializeSubSection(const String& name, const Section* section, String& destination, const String& parentPath) noexcept
+{
+	if (!Tools::IsNameValid(name))
+	{
+		PP_COUT_SYNTAX_ERROR("Invalid name for section: " << name);
+		return EResult::InvalidName;
+	}
+
+	for (const auto& comment : section->m_comments)
+	{
+		destination += comment;
+		destination += '\n';
+	}
+
+	String path = parentPath;
+	if (!path.empty())
+		path += '.';
+	path += name;
+
+	destination += '[';
+	destination += path;
+	destination += "]\n";
+	return SerializeSection(section, destination, path);
+}
+
+template<typename ChunkConsumer>
+minipp::EResult minipp::MiniPPFile::SerializeChunks(ChunkConsumer consumer) const noexcept
+{
+	// one top-level sub-section at a time, so only the biggest one has to fit in memory
+	String buffer;
+	auto result = SerializeValues(&m_rootSection, buffer);
+	if (!IsResultOk(result))
+		return result;
+
+	for (const auto& pair : m_rootSection.m_subSections)
+	{
+		result = consumer(buffer);
+		if (!IsResultOk(result))
+			return result;
+		buffer.clear();
+		result = SerializeSubSection(pair.first, pair.second, buffer, String());
+		if (!IsResultOk(result))
+			return result;
+	}
+	return consumer(buffer);
+}
+
+size_t minipp::MiniPPFile::MeasureSection(const Section* section, size_t pathLength) noexcept
+{
+	// mirrors SerializeValues / SerializeSubSection
+	size_t size = 0;
+	if (!section->m_values.empty())
+	{
+		for (const auto& pair : section->m_values)
+		{
+			for (const auto& comment : pair.second->m_comments)
+				size += comment.size() + 1;
+			size += pair.first.size() + 3 + pair.second->MeasureSerializedSize() + 1;
+		}
+		size += 1;
+	}
+
+	for (const auto& pair : section->m_subSections)
+	{
+		for (const auto& comment : pair.second->m_comments)
+			size += comment.size() + 1;
+		size_t childPathLength = (pathLength != 0 ? pathLength + 1 : 0) + pair.first.size();
+		size += childPathLength + 3 + MeasureSection(pair.second, childPathLength);
+	}
+	return size;
+}
+
+minipp::EResult minipp::MiniPPFile::SerializeParallel(unsigned threadCount, Vector<String>& buffers) const noexcept
+{
+	// buffers[0] holds the values of the root, buffers[i + 1] the i-th top-level sub-section in iteration order
+	Vector<std::pair<const String*, const Section*>> jobs;
+	jobs.reserve(m_rootSection.m_subSections.size());
+	for (const auto& pair : m_rootSection.m_subSections)
+		jobs.emplace_back(&pair.first, pair.second);
+
+	buffers.clear();
+	buffers.resize(jobs.size() + 1);
+	auto result = SerializeValues(&m_rootSection, buffers[0]);
+	if (!IsResultOk(result))
+		return result;
+
+	Vector<EResult> results(jobs.size(), EResult::Success);
+	std::atomic<size_t> nextJob(0);
+	auto worker = [&]()
+	{
+		for (size_t i = nextJob.fetch_add(1); i < jobs.size(); i = nextJob.fetch_add(1))
+			results[i] = SerializeSubSection(*jobs[i].first, jobs[i].second, buffers[i + 1], String());
+	};
+
+	std::vector<std::thread> threads;
+	size_t workerCount = std::min<size_t>(threadCount, jobs.size());
+	for (size_t i = 1; i < workerCount; ++i)
+	{
+		try
+		{
+			threads.emplace_back(worker);
+		}
+		catch (const std::system_error&)
+		{
+			break; // the remaining jobs are picked up by the threads that did start
+		}
+	}
+	worker();
+	for (auto& thread : threads)
+		thread.join();
+
+	for (const auto jobResult : results)
+		if (!IsResultOk(jobResult))
+			return jobResult;
+	return EResult::Success;
+}
+
+#if MINIPP_USE_PMR
+minipp::MiniPPFile::MiniPPFile(std::pmr::memory_resource* resource) noexcept
+	: m_memoryResource(resource), m_rootSection(resource)
+{
+}
+#endif
+
+minipp::MiniPPFile::MiniPPFile(MiniPPFile&& other) noexcept
+	:
+#if MINIPP_USE_PMR
+	m_memoryResource(other.m_memoryResource),
+#endif
+#if MINIPP_ENABLE_VALUE_POOL
+	m_valuePool(other.m_valuePool),
+#endif
+	m_rootSection(std::move(other.m_rootSection)),
+	m_handles(std::move(other.m_handles)),
+	m_watchers(std::move(other.m_watchers)),
+	m_defaults(other.m_defaults),
+	m_defaultsTable(std::move(other.m_defaultsTable))
+{
+	other.m_defaults = nullptr;
+	other.m_defaultsTable.clear();
+#if MINIPP_ENABLE_VALUE_POOL
+	other.m_valuePool = nullptr;
+#endif
+}
+
+minipp::MiniPPFile& minipp::MiniPPFile::operator=(MiniPPFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		// the old tree (and pool) go away with temporary
+		MiniPPFile temporary(std::move(other));
+		Swap(temporary);
+		// the handles and cached values of other follow its tree
+		m_handles.reserve(m_handles.size() + temporary.m_handles.size());
+		for (auto& slot : temporary.m_handles)
+			m_handles.push_back(std::move(slot));
+		temporary.m_handles.clear();
+		m_watchers.reserve(m_watchers.size() + temporary.m_watchers.size());
+		for (auto& watcher : temporary.m_watchers)
+			m_watchers.push_back(std::move(watcher));
+		temporary.m_watchers.clear();
+		if (m_defaults == nullptr)
+			m_defaults = temporary.m_defaults;
+		RefreshHandles();
+	}
+	return *this;
+}
+
+void minipp::MiniPPFile::Swap(MiniPPFile& other) noexcept
+{
+#if MINIPP_ENABLE_VALUE_POOL
+	std::swap(m_valuePool, other.m_valuePool);
+#endif
+	m_rootSection.Swap(other.m_rootSection);
+	// handles and cached values stay with the object, so swapping in a freshly parsed file reloads them as well
+	RefreshHandles();
+	other.RefreshHandles();
+}
+
+minipp::MiniPPFile::~MiniPPFile()
+{
+	InvalidateHandles();
+#if MINIPP_ENABLE_VALUE_POOL
+	// the values have to go back to the pool before it is released
+	m_rootSection.Clear();
+	if (m_valuePool != nullptr)
+		m_valuePool->Release();
+#endif
+}
+
+#if MINIPP_ENABLE_VALUE_POOL
+void minipp::MiniPPFile::EnableValuePool()
+{
+	if (m_valuePool == nullptr)
+#if MINIPP_USE_PMR
+		m_valuePool = new ValuePool(m_memoryResource);
+#else
+		m_valuePool = new ValuePool();
+#endif
+}
+#endif
+
+minipp::EResult minipp::MiniPPFile::Parse(const std::string& path, bool additional) noexcept
+{
+	return Parse(path, ParseOptions{}, additional);
+}
+
+minipp::EResult minipp::MiniPPFile::Parse(std::ifstream& ifs, bool additional) noexcept
+{
+	return Parse(ifs, ParseOptions{}, additional);
+}
+
+minipp::EResult minipp::MiniPPFile::Parse(const std::string& path, const ParseOptions& options, bool additional) noexcept
+{
+	std::ifstream ifs;
+	Codec codec;
+	if (!FindCodec(path, &codec))
+	{
+		ifs.open(path);
+		return Parse(ifs, options, additional);
+	}
+
+	ifs.open(path, std::ios::binary);
+	std::unique_ptr<Decoder> decoder;
+	if (ifs.is_open() && codec.createDecoder != nullptr)
+		decoder = codec.createDecoder();
+	if (decoder == nullptr)
+	{
+		if (ifs.is_open())
+			PP_COUT("No decoder available for " << codec.extension << " files");
+		ifs.setstate(std::ios::failbit);
+		return Parse(ifs, options, additional);
+	}
+
+	DecodingStreamBuffer buffer(ifs, std::move(decoder));
+	std::istream input(&buffer);
+	auto result = Parse(input, options, additional);
+	// a decoding error looks like the end of the file to the parser
+	return IsResultOk(buffer.GetResult()) ? result : buffer.GetResult();
+}
+
+minipp::EResult minipp::MiniPPFile::Parse(std::ifstream& ifs, const ParseOptions& options, bool additional) noexcept
+{
+	// an ifstream that was never opened isn't necessarily failed yet
+	if (!ifs.is_open())
+		ifs.setstate(std::ios::failbit);
+	return Parse(static_cast<std::istream&>(ifs), options, additional);
+}
+
+minipp::EResult minipp::MiniPPFile::Parse(std::istream& input, bool additional) noexcept
+{
+	return Parse(input, ParseOptions{}, additional);
+}
+
+minipp::EResult minipp::MiniPPFile::Parse(std::istream& input, const ParseOptions& options, bool additional) noexcept
+{
+	if (!additional)
+	{
+		InvalidateHandles();
+		m_defaultsTable.clear();
+	}
+	auto result = ParseStream(input, options, additional);
+	RefreshHandles();
+	return result;
+}
+
+void minipp::MiniPPFile::InvalidateHandles() noexcept
+{
+	// before the values are deleted, so no handle dangles meanwhile
+	for (auto& weakSlot : m_handles)
+	{
+		auto slot = weakSlot.lock();
+		if (slot != nullptr)
+			slot->Assign(nullptr);
+	}
+}
+
+void minipp::MiniPPFile::RefreshHandles() noexcept
+{
+	size_t kept = 0;
+	for (size_t i = 0; i < m_handles.size(); i++)
+	{
+		auto slot = m_handles[i].lock();
+		if (slot == nullptr)
+			continue;
+
+		Value* value = nullptr;
+		if (m_rootSection.GetValue(slot->path, &value) == EResult::Success)
+			value = slot->filter(value);
+		else
+			value = nullptr;
+		slot->Assign(value);
+
+		if (kept != i)
+			m_handles[kept] = std::move(m_handles[i]);
+		kept++;
+	}
+	m_handles.erase(m_handles.begin() + kept, m_handles.end());
+
+	kept = 0;
+	for (size_t i = 0; i < m_watchers.size(); i++)
+	{
+		auto watcher = m_watchers[i].lock();
+		if (watcher == nullptr)
+			continue;
+
+		watcher->Refresh(m_rootSection);
+
+		if (kept != i)
+			m_watchers[kept] = std::move(m_watchers[i]);
+		kept++;
+	}
+	m_watchers.erase(m_watchers.begin() + kept, m_watchers.end());
+
+	BindDefaults();
+}
+
+void minipp::MiniPPFile::SetDefaults(const Defaults* defaults) noexcept
+{
+	m_defaults = defaults;
+	BindDefaults();
+}
+
+void minipp::MiniPPFile::BindDefaults() noexcept
+{
+	m_defaultsTable.clear();
+	if (m_defaults == nullptr)
+		return;
+
+	m_defaultsTable.resize(m_defaults->GetCount());
+	for (Defaults::Id id = 0; id < m_defaultsTable.size(); ++id)
+	{
+		const Value* defaultValue = m_defaults->GetDefault(id);
+		Value* value = nullptr;
+		if (m_rootSection.GetValue(m_defaults->GetPath(id), &value) == EResult::Success && value->GetType() == defaultValue->GetType())
+			m_defaultsTable[id] = value;
+		else
+			m_defaultsTable[id] = defaultValue;
+	}
+}
+
+minipp::EResult minipp::MiniPPFile::ParseStream(std::istream& input, const ParseOptions& options, bool additional) noexcept
+{
+#define PP_COUT_HERE() PP_COUT_SYNTAX_ERROR_LINE(lineCounter, currentLine << " <- HERE");
+	if (!additional)
+		m_rootSection.Clear();
+
+#if MINIPP_ENABLE_VALUE_POOL
+	ValuePool::Scope poolScope(m_valuePool != nullptr ? m_valuePool : ValuePool::GetCurrent());
+#endif
+#if MINIPP_USE_PMR
+	ResourceScope resourceScope(m_memoryResource);
+#endif
+
+	if (!input)
+		return EResult::FileIOError;
+
+	SectionSizeHints sizeHints;
+	if (options.reserveFromPreScan)
+		PreScan(input, sizeHints);
+
+	auto reserveFromHint = [&sizeHints](Section* section, const String& path)
+	{
+		auto it = sizeHints.find(path);
+		if (it != sizeHints.end())
+			section->Reserve(section->m_values.size() + it->second.valueCount, section->m_subSections.size() + it->second.subSectionCount);
+	};
+	reserveFromHint(&m_rootSection, String());
+
+	int64_t lineCounter = 0;
+	Section* currentSection = nullptr;
+
+	Vector<String> commentBuffer;
+
+	const Overrides* overrides = options.overrides;
+	const HashMap<String, uint32_t>* sectionOverrides = nullptr;
+	Vector<uint8_t> overrideApplied;
+	if (overrides != nullptr)
+		overrideApplied.resize(overrides->m_entries.size());
+
+	const Schema* schema = options.schema;
+	const Schema::SectionRule* schemaSection = nullptr;
+	String schemaSectionPath;
+	// required keys seen per schema section id
+	Vector<uint32_t> requiredSeen;
+	if (schema != nullptr)
+		requiredSeen.resize(schema->m_sections.size());
+
+	SourceMap* sourceMap = options.sourceMap;
+	if (sourceMap != nullptr && !additional)
+		sourceMap->Clear();
+	uint64_t lineOffset = 0;
+	uint64_t nextLineOffset = 0;
+	size_t indentation = 0;
+	String currentLine;
+	auto recordPosition = [&](const void* node)
+	{
+		SourcePosition position;
+		position.offset = lineOffset + indentation;
+		position.line = static_cast<uint32_t>(lineCounter);
+		position.column = static_cast<uint32_t>(indentation + 1);
+		position.length = static_cast<uint32_t>(currentLine.size());
+		sourceMap->Record(node, position);
+	};
+
+	while (std::getline(input, currentLine))
+	{
+		++lineCounter;
+		if (sourceMap != nullptr)
+		{
+			lineOffset = nextLineOffset;
+			nextLineOffset += currentLine.size() + 1;
+			indentation = currentLine.find_first_not_of(" \t");
+		}
+		Tools::StringTrim(currentLine);
+		if (currentLine.empty())
+			continue;
+		char firstChar = currentLine[0];
+		char lastChar = currentLine[currentLine.size() - 1];
+
+		if (firstChar == '#')
+		{
+			commentBuffer.push_back(currentLine);
+			continue;
+		}
+
+		if (firstChar == '[')
+		{
+			if (lastChar != ']')
+			{
+				PP_COUT_SYNTAX_ERROR("Expected ']' at the end of the line.");
+				PP_COUT_HERE();
+				return EResult::SectionExpectedClosingBracket;
+			}
+			String sectionPathStr = currentLine.substr(1, currentLine.size() - 2);
+			Tools::StringTrim(sectionPathStr);
+			if (sectionPathStr.empty())
+			{
+				PP_COUT_SYNTAX_ERROR("Expected section path. Found empty section begin notation.");
+				PP_COUT_HERE();
+				return EResult::EmptySectionName;
+			}
+			// Create section tree
+			Section* ubSection = &m_rootSection;
+
+			Vector<String> sectionPath = Tools::SplitByDelimiter(sectionPathStr, '.');
+			String sectionPrefix;
+			EResult result;
+			for (size_t i = 0; i < sectionPath.size(); ++i)
+			{
+				const String& sectionName = sectionPath[i];
+				if (!Tools::IsNameValid(sectionName))
+				{
+					PP_COUT_SYNTAX_ERROR("Invalid section name. (\"" << sectionName << "\") May only contain [a - z][A - Z][0 - 9] and _.");
+					PP_COUT_HERE();
+					return EResult::InvalidName;
+				}
+
+				if (!sizeHints.empty())
+				{
+					if (i != 0)
+						sectionPrefix += '.';
+					sectionPrefix += sectionName;
+				}
+
+				result = ubSection->EmplaceSubSection(std::move(sectionPath[i]), &ubSection);
+				if (result == EResult::Success && !sizeHints.empty())
+					reserveFromHint(ubSection, sectionPrefix);
+				if (result == EResult::SectionAlreadyPresent && i == sectionPath.size() - 1)
+				{
+					PP_COUT_SYNTAX_ERROR("All (sub-) sections may only be defined once.");
+					PP_COUT_HERE();
+					return EResult::SectionAlreadyPresent;
+				}
+			}
+			currentSection = ubSection;
+			currentSection->m_comments = std::move(commentBuffer);
+			commentBuffer.clear();
+			if (sourceMap != nullptr)
+				recordPosition(currentSection);
+
+			if (overrides != nullptr)
+				sectionOverrides = overrides->FindSection(sectionPathStr);
+			if (schema != nullptr)
+			{
+				schemaSection = schema->FindSection(sectionPathStr);
+				if (schemaSection == nullptr && !schema->IsUnknownSectionAllowed(sectionPathStr))
+				{
+					PP_COUT("Schema violation: unknown section " << sectionPathStr);
+					PP_COUT_HERE();
+					return EResult::SchemaViolation;
+				}
+				schemaSectionPath = std::move(sectionPathStr);
+			}
+			continue;
+		}
+		if (currentSection == nullptr)
+		{
+			PP_COUT_SYNTAX_ERROR("Expected section begin before key-value pair.");
+			PP_COUT_HERE();
+			return EResult::KeyValuePairNotInSection;
+		}
+
+		int64_t keyValueDelimiterIndex = Tools::FirstIndexOf(currentLine, '=');
+		if (keyValueDelimiterIndex == -1)
+		{
+			PP_COUT_SYNTAX_ERROR("Expected '=' in line.");
+			PP_COUT_HERE();
+			return EResult::ExpectedKeyValuePair;
+		}
+
+		auto keyValuePair = Tools::SplitInTwo(currentLine, keyValueDelimiterIndex);
+		Tools::StringTrim(keyValuePair.first);
+		Tools::StringTrim(keyValuePair.second);
+
+		if (keyValuePair.first.empty())
+		{
+			PP_COUT_SYNTAX_ERROR("Expected key in line.");
+			PP_COUT_HERE();
+			return EResult::KeyEmpty;
+		}
+		if (!Tools::IsNameValid(keyValuePair.first))
+		{
+			PP_COUT_SYNTAX_ERROR("Invalid key name. (\"" << keyValuePair.first << "\") May only contain [a - z][A - Z][0 - 9] and _.");
+			PP_COUT_HERE();
+			return EResult::InvalidName;
+		}
+
+		if (keyValuePair.second.empty())
+		{
+			PP_COUT_SYNTAX_ERROR("Empty keys are not allowed");
+			PP_COUT_HERE();
+			return EResult::ValueEmpty;
+		}
+		EResult parseResult;
+		std::unique_ptr<Value> parsedValue;
+		if (options.lazyArrayThreshold != 0 && keyValuePair.second.size() >= options.lazyArrayThreshold &&
+			keyValuePair.second.front() == '[' && keyValuePair.second.back() == ']')
+		{
+			auto arrayValue = std::make_unique<Values::ArrayValue>();
+			parseResult = arrayValue->ParseLazy(std::move(keyValuePair.second));
+			if (IsResultOk(parseResult))
+				parsedValue = std::move(arrayValue);
+		}
+		else
+			parsedValue = Value::ParseValue(keyValuePair.second, &parseResult);
+		if (parsedValue == nullptr)
+		{
+			PP_COUT_HERE();
+			return parseResult;
+		}
+		if (sectionOverrides != nullptr)
+		{
+			auto overrideIt = sectionOverrides->find(keyValuePair.first);
+			if (overrideIt != sectionOverrides->end())
+			{
+				auto replacement = overrides->ParseEntry(overrideIt->second, &parseResult);
+				if (replacement == nullptr)
+					return parseResult;
+				auto kindResult = CheckOverrideKind(parsedValue.get(), replacement.get());
+				if (kindResult != EResult::Success)
+				{
+					PP_COUT("Override of " << keyValuePair.first << " doesn't match the kind of the value in the file");
+					PP_COUT_HERE();
+					return kindResult;
+				}
+				parsedValue = std::move(replacement);
+				overrideApplied[overrideIt->second] = 1;
+			}
+		}
+		if (schema != nullptr)
+		{
+			auto schemaResult = schema->CheckKey(schemaSection, schemaSectionPath, keyValuePair.first, parsedValue.get(), &requiredSeen);
+			if (schemaResult != EResult::Success)
+			{
+				PP_COUT_HERE();
+				return schemaResult;
+			}
+		}
+		parsedValue->m_comments = std::move(commentBuffer);
+		commentBuffer.clear();
+
+		const Value* value = parsedValue.get();
+		auto valueSetResult = currentSection->SetValue(keyValuePair.first, std::move(parsedValue), false);
+		if (valueSetResult != EResult::Success)
+		{
+			PP_COUT_SYNTAX_ERROR("Key already present: " << keyValuePair.first);
+			PP_COUT_HERE();
+			return valueSetResult;
+		}
+		if (sourceMap != nullptr)
+			recordPosition(value);
+	}
+
+	if (overrides != nullptr)
+	{
+		auto overrideResult = AddRemainingOverrides(*overrides, overrideApplied, schema, &requiredSeen);
+		if (overrideResult != EResult::Success)
+			return overrideResult;
+	}
+	if (schema != nullptr)
+		return schema->CheckRequired(m_rootSection, &requiredSeen);
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::CheckOverrideKind(const Value* original, const Value* replacement) noexcept
+{
+	if (original->GetType() != replacement->GetType())
+		return EResult::InvalidDataType;
+	if (original->GetType() != EValueType::Array)
+		return EResult::Success;
+
+	// empty arrays go with any element type
+	EValueType originalElementType;
+	EValueType replacementElementType;
+	if (static_cast<const Values::ArrayValue*>(original)->GetElementType(&originalElementType) != EResult::Success ||
+		static_cast<const Values::ArrayValue*>(replacement)->GetElementType(&replacementElementType) != EResult::Success)
+		return EResult::Success;
+	return originalElementType == replacementElementType ? EResult::Success : EResult::InvalidDataType;
+}
+
+minipp::EResult minipp::MiniPPFile::AddRemainingOverrides(const Overrides& overrides, const Vector<uint8_t>& applied, const Schema* schema, Vector<uint32_t>* requiredSeen) noexcept
+{
+	for (uint32_t id = 0; id < overrides.m_entries.size(); ++id)
+	{
+		if (applied[id])
+			continue;
+		const auto& entry = overrides.m_entries[id];
+
+		Section* section = &m_rootSection;
+		for (auto& name : Tools::SplitByDelimiter(entry.sectionPath, '.'))
+			section->EmplaceSubSection(std::move(name), &section);
+
+		EResult result;
+		auto value = overrides.ParseEntry(id, &result);
+		if (value == nullptr)
+			return result;
+
+		// only with additional parses: the key came from an earlier file
+		auto existing = section->GetValues().find(entry.key);
+		if (existing != section->GetValues().end())
+		{
+			result = CheckOverrideKind(existing->second, value.get());
+			if (result != EResult::Success)
+			{
+				PP_COUT("Override of " << entry.sectionPath << '.' << entry.key << " doesn't match the kind of the existing value");
+				return result;
+			}
+			value->m_comments = existing->second->m_comments;
+		}
+
+		if (schema != nullptr)
+		{
+			auto schemaSection = schema->FindSection(entry.sectionPath);
+			if (schemaSection == nullptr && !schema->IsUnknownSectionAllowed(entry.sectionPath))
+			{
+				PP_COUT("Schema violation: unknown section " << entry.sectionPath);
+				return EResult::SchemaViolation;
+			}
+			result = schema->CheckKey(schemaSection, entry.sectionPath, entry.key, value.get(), requiredSeen);
+			if (result != EResult::Success)
+				return result;
+		}
+
+		section->SetValue(entry.key, std::move(value), true);
+	}
+	return EResult::Success;
+}
+
+void minipp::MiniPPFile::PreScan(std::istream& input, SectionSizeHints& hints)
+{
+	// Only looks at the first character of each line: '[' opens a section, '#' is a comment, anything else
+	// counts as a key. The numbers are estimates for reserve, Parse still does all the validation.
+	auto start = input.tellg();
+	if (start == std::streampos(-1))
+		return;
+
+	SectionSizeHint* current = nullptr;
+	String line;
+	auto scanLine = [&]()
+	{
+		size_t first = 0;
+		size_t last = line.size();
+		while (first < last && (line[first] == ' ' || line[first] == '\t'))
+			++first;
+		while (last > first && (line[last - 1] == ' ' || line[last - 1] == '\t'))
+			--last;
+		if (first == last || line[first] == '#')
+			return;
+
+		if (line[first] != '[')
+		{
+			if (current != nullptr)
+				++current->valueCount;
+			return;
+		}
+		if (line[last - 1] != ']' || last - first < 2)
+			return;
+
+		++first;
+		--last;
+		while (first < last && (line[first] == ' ' || line[first] == '\t'))
+			++first;
+		while (last > first && (line[last - 1] == ' ' || line[last - 1] == '\t'))
+			--last;
+
+		String path = line.substr(first, last - first);
+		size_t parentLength = path.rfind('.');
+		++hints[parentLength == String::npos ? String() : path.substr(0, parentLength)].subSectionCount;
+		current = &hints[path]; // references into unordered_map nodes survive rehashing
+	};
+
+	Vector<char> buffer(64 * 1024);
+	while (input.read(buffer.data(), buffer.size()) || input.gcount() > 0)
+	{
+		const char* cursor = buffer.data();
+		const char* end = cursor + input.gcount();
+		while (cursor < end)
+		{
+			auto newline = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+			if (newline == nullptr)
+			{
+				line.append(cursor, end);
+				break;
+			}
+			line.append(cursor, newline);
+			scanLine();
+			line.clear();
+			cursor = newline + 1;
+		}
+	}
+	if (!line.empty())
+		scanLine();
+
+	input.clear();
+	input.seekg(start);
+}
+
+#if MINIPP_POSIX
+namespace minipp
+{
+	namespace detail
+	{
+		inline EResult WriteVectored(const std::string& path, const Vector<String>& buffers) noexcept
+		{
+#ifdef IOV_MAX
+			constexpr size_t maxVectors = IOV_MAX;
+#else
+			constexpr size_t maxVectors = 1024;
+#endif
+
+			int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+			if (fd < 0)
+				return EResult::FileIOError;
+
+			std::vector<iovec> vectors;
+			bool failed = false;
+			size_t next = 0;
+			while (!failed && next < buffers.size())
+			{
+				vectors.clear();
+				for (; next < buffers.size() && vectors.size() < maxVectors; ++next)
+					if (!buffers[next].empty())
+						vectors.push_back({ const_cast<char*>(buffers[next].data()), buffers[next].size() });
+
+				size_t first = 0;
+				while (first < vectors.size())
+				{
+					ssize_t written = ::writev(fd, vectors.data() + first, static_cast<int>(vectors.size() - first));
+					if (written < 0)
+					{
+						if (errno == EINTR)
+							continue;
+						failed = true;
+						break;
+					}
+
+					// partial writes stop anywhere, skip what made it out and retry the rest
+					size_t remaining = static_cast<size_t>(written);
+					while (first < vectors.size() && remaining >= vectors[first].iov_len)
+						remaining -= vectors[first++].iov_len;
+					if (first < vectors.size())
+					{
+						vectors[first].iov_base = static_cast<char*>(vectors[first].iov_base) + remaining;
+						vectors[first].iov_len -= remaining;
+					}
+				}
+			}
+
+			if (::close(fd) != 0)
+				failed = true;
+			return failed ? EResult::FileIOError : EResult::Success;
+		}
+	}
+}
+#endif
+
+minipp::EResult minipp::MiniPPFile::Write(const std::string& path) const noexcept
+{
+	return Write(path, WriteOptions{});
+}
+
+minipp::EResult minipp::MiniPPFile::Write(std::ofstream& ofs) const noexcept
+{
+	return Write(ofs, WriteOptions{});
+}
+
+minipp::EResult minipp::MiniPPFile::Write(const std::string& path, const WriteOptions& options) const noexcept
+{
+	Codec codec;
+	if (FindCodec(path, &codec))
+	{
+		// before opening, which truncates the file
+		std::unique_ptr<Encoder> encoder;
+		if (codec.createEncoder != nullptr)
+			encoder = codec.createEncoder();
+		if (encoder == nullptr)
+		{
+			PP_COUT("No encoder available for " << codec.extension << " files");
+			return EResult::FileIOError;
+		}
+		std::ofstream ofs(path, std::ios::binary);
+		if (!ofs.is_open())
+			return EResult::FileIOError;
+
+		StreamSink fileSink(ofs);
+		EncodingSink sink(fileSink, std::move(encoder));
+		auto result = Write(sink, options);
+		if (!IsResultOk(result))
+			return result;
+		result = sink.Finish();
+		if (!IsResultOk(result))
+			return result;
+		result = fileSink.Flush();
+		if (!IsResultOk(result))
+			return result;
+		ofs.close();
+		return ofs.fail() ? EResult::FileIOError : result;
+	}
+
+#if MINIPP_POSIX
+	if (options.threadCount > 1)
+	{
+		Vector<String> buffers;
+		auto result = SerializeParallel(options.threadCount, buffers);
+		if (!IsResultOk(result))
+			return result;
+		return detail::WriteVectored(path, buffers);
+	}
+#endif
+
+	std::ofstream ofs;
+	ofs.open(path);
+
+	auto result = Write(ofs, options);
+	if (!IsResultOk(result))
+		return result;
+	// whatever is still buffered only reaches the file here, a full disk shows up as a failed close
+	ofs.close();
+	return ofs.fail() ? EResult::FileIOError : result;
+}
+
+minipp::EResult minipp::MiniPPFile::Write(std::ofstream& ofs, const WriteOptions& options) const noexcept
+{
+	if (!ofs.is_open())
+		return EResult::FileIOError;
+
+	if (options.threadCount > 1)
+	{
+		Vector<String> buffers;
+		auto result = SerializeParallel(options.threadCount, buffers);
+		if (!IsResultOk(result))
+			return result;
+		for (const auto& buffer : buffers)
+			ofs.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		return ofs.fail() ? EResult::FileIOError : EResult::Success;
+	}
+
+	auto result = SerializeChunks([&ofs](const String& chunk)
+	{
+		ofs.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+		return EResult::Success;
+	});
+	if (!IsResultOk(result))
+		return result;
+
+	return ofs.fail() ? EResult::FileIOError : EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::Write(OutputSink& sink) const noexcept
+{
+	return Write(sink, WriteOptions{});
+}
+
+minipp::EResult minipp::MiniPPFile::Write(OutputSink& sink, const WriteOptions& options) const noexcept
+{
+	EResult result;
+	if (options.threadCount > 1)
+	{
+		Vector<String> buffers;
+		result = SerializeParallel(options.threadCount, buffers);
+		for (size_t i = 0; i < buffers.size() && IsResultOk(result); ++i)
+			result = sink.Write(buffers[i].data(), buffers[i].size());
+	}
+	else
+	{
+		result = SerializeChunks([&sink](const String& chunk)
+		{
+			return sink.Write(chunk.data(), chunk.size());
+		});
+	}
+	if (!IsResultOk(result))
+		return result;
+	return sink.Flush();
+}
+
+minipp::EResult minipp::MiniPPFile::WriteJsonSection(const Section* section, String& buffer, OutputSink& sink) noexcept
+{
+	constexpr size_t flushThreshold = 64 * 1024;
+
+	buffer += '{';
+	bool isFirst = true;
+	for (const auto& pair : section->m_values)
+	{
+		if (!isFirst)
+			buffer += ',';
+		isFirst = false;
+
+		Tools::AppendJsonString(buffer, pair.first.data(), pair.first.size());
+		buffer += ':';
+		auto result = pair.second->AppendJson(buffer);
+		if (!IsResultOk(result))
+			return result;
+
+		if (buffer.size() >= flushThreshold)
+		{
+			result = sink.Write(buffer.data(), buffer.size());
+			buffer.clear();
+			if (!IsResultOk(result))
+				return result;
+		}
+	}
+
+	for (const auto& pair : section->m_subSections)
+	{
+		if (!isFirst)
+			buffer += ',';
+		isFirst = false;
+
+		Tools::AppendJsonString(buffer, pair.first.data(), pair.first.size());
+		buffer += ':';
+		auto result = WriteJsonSection(pair.second, buffer, sink);
+		if (!IsResultOk(result))
+			return result;
+	}
+
+	buffer += '}';
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::WriteJson(OutputSink& sink) const noexcept
+{
+	String buffer;
+	auto result = WriteJsonSection(&m_rootSection, buffer, sink);
+	if (!IsResultOk(result))
+		return result;
+
+	result = sink.Write(buffer.data(), buffer.size());
+	if (!IsResultOk(result))
+		return result;
+	return sink.Flush();
+}
+
+size_t minipp::MiniPPFile::MeasureSerializedSize() const noexcept
+{
+	return MeasureSection(&m_rootSection, 0);
+}
+
+minipp::EResult minipp::MiniPPFile::WriteToBuffer(String& destination) const noexcept
+{
+	destination.clear();
+	destination.reserve(MeasureSerializedSize());
+	return SerializeSection(&m_rootSection, destination, String());
+}
+
+minipp::EResult minipp::MiniPPFile::WriteToBuffer(char* destination, size_t capacity, size_t* written) const noexcept
+{
+	size_t offset = 0;
+	auto result = SerializeChunks([&](const String& chunk)
+	{
+		if (chunk.size() > capacity - offset)
+			return EResult::BufferTooSmall;
+		std::memcpy(destination + offset, chunk.data(), chunk.size());
+		offset += chunk.size();
+		return EResult::Success;
+	});
+
+	if (written != nullptr)
+		*written = offset;
+	return result;
+}
+
+minipp::EResult minipp::MiniPPFile::WriteMapped(const std::string& path) const noexcept
+{
+	// the compressed size isn't known up front. Write checks for an encoder before it touches the file.
+	Codec codec;
+	if (FindCodec(path, &codec))
+		return Write(path);
+
+	size_t size = MeasureSerializedSize();
+
+#if MINIPP_POSIX
+	int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	if (fd < 0)
+		return EResult::FileIOError;
+
+	bool failed = ::ftruncate(fd, static_cast<off_t>(size)) != 0;
+#if defined(__linux__)
+	// allocates the blocks now, a full disk would otherwise only show up as SIGBUS while writing the mapping
+	if (!failed && size != 0)
+	{
+		int error = ::posix_fallocate(fd, 0, static_cast<off_t>(size));
+		failed = error != 0 && error != EINVAL && error != EOPNOTSUPP;
+	}
+#endif
+
+	EResult result = EResult::Success;
+	size_t written = 0;
+	if (!failed && size != 0)
+	{
+		void* mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (mapping == MAP_FAILED)
+			failed = true;
+		else
+		{
+			result = WriteToBuffer(static_cast<char*>(mapping), size, &written);
+			::munmap(mapping, size);
+			if (written != size) // only on errors, keep what was serialized like Write does
+				failed = ::ftruncate(fd, static_cast<off_t>(written)) != 0;
+		}
+	}
+
+	if (::close(fd) != 0)
+		failed = true;
+	if (!IsResultOk(result))
+		return result;
+	return failed ? EResult::FileIOError : EResult::Success;
+#else
+	String buffer;
+	buffer.reserve(size);
+	auto result = SerializeSection(&m_rootSection, buffer, String());
+	if (!IsResultOk(result))
+		return result;
+
+	std::ofstream ofs(path, std::ios::binary);
+	ofs.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+	return ofs.fail() ? EResult::FileIOError : EResult::Success;
+#endif
+}
+
+bool minipp::MiniPPFile::IsResultOk(EResult result) noexcept
+{
+	return static_cast<int32_t>(result) > 0;
+}
+
+minipp::ESimdLevel minipp::MiniPPFile::GetSimdLevel() noexcept
+{
+	return detail::GetKernels().level;
+}
+
+minipp::ESimdLevel minipp::MiniPPFile::ForceSimdLevel(ESimdLevel level) noexcept
+{
+	ESimdLevel supportedLevel = detail::DetectSimdLevel();
+	if (level > supportedLevel)
+		level = supportedLevel;
+
+	detail::g_kernels.store(detail::GetKernelsForLevel(level), std::memory_order_release);
+	return level;
+}
+
+#pragma region Schema
+uint32_t minipp::MiniPPFile::Schema::InternSection(const String& path)
+{
+	auto inserted = m_sectionIds.emplace(path, static_cast<uint32_t>(m_sections.size()));
+	if (inserted.second)
+	{
+		m_sections.emplace_back();
+		m_sections.back().path = path;
+	}
+	return inserted.first->second;
+}
+
+const minipp::MiniPPFile::Schema::SectionRule* minipp::MiniPPFile::Schema::FindSection(const String& path) const noexcept
+{
+	auto it = m_sectionIds.find(path);
+	return it != m_sectionIds.end() ? &m_sections[it->second] : nullptr;
+}
+
+bool minipp::MiniPPFile::Schema::IsUnknownSectionAllowed(const String& path) const noexcept
+{
+	// the closest declared ancestor decides
+	String prefix = path;
+	while (!prefix.empty())
+	{
+		auto separator = Tools::LastIndexOf(prefix, '.');
+		prefix = separator == -1 ? String() : prefix.substr(0, static_cast<size_t>(separator));
+		auto section = FindSection(prefix);
+		if (section != nullptr)
+			return section->allowUnknown;
+	}
+	return false;
+}
+
+minipp::EResult minipp::MiniPPFile::Schema::CheckValue(const KeyRule& rule, const Value* value) noexcept
+{
+	if (value->GetType() != rule.type)
+		return EResult::SchemaViolation;
+
+	bool inRange = true;
+	switch (rule.type)
+	{
+	case EValueType::Int:
+	{
+		auto number = static_cast<const Values::IntValue*>(value)->GetValue();
+		inRange = number >= rule.minInt && number <= rule.maxInt;
+		break;
+	}
+	case EValueType::Float:
+	{
+		auto number = static_cast<const Values::FloatValue*>(value)->GetValue();
+		inRange = !(number < rule.minFloat) && !(number > rule.maxFloat);
+		break;
+	}
+	case EValueType::String:
+	{
+		auto length = static_cast<const Values::StringValue*>(value)->GetValue().size();
+		inRange = length >= rule.minSize && length <= rule.maxSize;
+		break;
+	}
+	case EValueType::Array:
+	{
+		auto array = static_cast<const Values::ArrayValue*>(value);
+		auto size = array->GetSize();
+		inRange = size >= rule.minSize && size <= rule.maxSize;
+		EValueType elementType;
+		if (inRange && rule.checkElementType && array->GetElementType(&elementType) == EResult::Success)
+			inRange = elementType == rule.elementType;
+		break;
+	}
+	case EValueType::Boolean:
+		break;
+	}
+
+	return inRange ? EResult::Success : EResult::SchemaViolation;
+}
+
+minipp::EResult minipp::MiniPPFile::Schema::CheckKey(const SectionRule* section, const String& sectionPath, const String& key, const Value* value, Vector<uint32_t>* requiredSeen) const noexcept
+{
+	// undeclared section below one that allows unknown contents
+	if (section == nullptr)
+		return EResult::Success;
+
+	auto it = section->keyIds.find(key);
+	if (it == section->keyIds.end())
+	{
+		if (section->allowUnknown)
+			return EResult::Success;
+		PP_COUT("Schema violation: unknown key " << sectionPath << '.' << key);
+		return EResult::SchemaViolation;
+	}
+
+	const auto& rule = section->keys[it->second];
+	if (CheckValue(rule, value) != EResult::Success)
+	{
+		PP_COUT("Schema violation: " << sectionPath << '.' << key << " has the wrong type or is out of range");
+		return EResult::SchemaViolation;
+	}
+	if (rule.required && requiredSeen != nullptr)
+		++(*requiredSeen)[static_cast<size_t>(section - m_sections.data())];
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::Schema::CheckRequired(const Section& root, const Vector<uint32_t>* requiredSeen) const noexcept
+{
+	for (size_t id = 0; id < m_sections.size(); ++id)
+	{
+		const auto& rule = m_sections[id];
+		if (rule.requiredCount == 0 || (requiredSeen != nullptr && (*requiredSeen)[id] == rule.requiredCount))
+			continue;
+
+		// some required key wasn't seen (or was set before this parse), look them up
+		const Section* section = &root;
+		for (const auto& name : Tools::SplitByDelimiter(rule.path, '.'))
+		{
+			auto it = section->GetSubSections().find(name);
+			if (it == section->GetSubSections().end())
+			{
+				PP_COUT("Schema violation: missing section " << rule.path);
+				return EResult::SchemaViolation;
+			}
+			section = it->second;
+		}
+		for (size_t key = 0; key < rule.keys.size(); ++key)
+		{
+			if (rule.keys[key].required && section->GetValues().find(rule.keyNames[key]) == section->GetValues().end())
+			{
+				PP_COUT("Schema violation: missing key " << rule.path << '.' << rule.keyNames[key]);
+				return EResult::SchemaViolation;
+			}
+		}
+	}
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::Schema::ValidateSection(const Section& section, const String& path) const noexcept
+{
+	auto rule = FindSection(path);
+	if (rule == nullptr && !path.empty() && !IsUnknownSectionAllowed(path))
+	{
+		PP_COUT("Schema violation: unknown section " << path);
+		return EResult::SchemaViolation;
+	}
+
+	for (const auto& entry : section.GetValues())
+	{
+		auto result = CheckKey(rule, path, entry.first, entry.second, nullptr);
+		if (result != EResult::Success)
+			return result;
+	}
+	for (const auto& entry : section.GetSubSections())
+	{
+		String childPath = path;
+		if (!childPath.empty())
+			childPath += '.';
+		childPath += entry.first;
+		auto result = ValidateSection(*entry.second, childPath);
+		if (result != EResult::Success)
+			return result;
+	}
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::Schema::AddSection(const String& path, bool allowUnknown)
+{
+	if (!path.empty())
+	{
+		if (path.back() == '.')
+			return EResult::InvalidName;
+		for (const auto& name : Tools::SplitByDelimiter(path, '.'))
+			if (name.empty() || !Tools::IsNameValid(name))
+				return EResult::InvalidName;
+	}
+
+	InternSection(String());
+	for (size_t i = 0; i < path.size(); ++i)
+		if (path[i] == '.')
+			InternSection(path.substr(0, i));
+	auto id = InternSection(path);
+	if (allowUnknown)
+		m_sections[id].allowUnknown = true;
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::Schema::AddKey(const String& sectionPath, const String& key, const KeyRule& rule)
+{
+	if (sectionPath.empty())
+		return EResult::KeyValuePairNotInSection;
+	if (key.empty() || !Tools::IsNameValid(key))
+		return EResult::InvalidName;
+	auto result = AddSection(sectionPath);
+	if (result != EResult::Success)
+		return result;
+
+	auto& section = m_sections[m_sectionIds.find(sectionPath)->second];
+	auto inserted = section.keyIds.emplace(key, static_cast<uint32_t>(section.keys.size()));
+	if (!inserted.second)
+		return EResult::KeyAlreadyPresent;
+	section.keyNames.push_back(key);
+	section.keys.push_back(rule);
+	if (rule.required)
+		++section.requiredCount;
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::Schema::Parse(const std::string& path) noexcept
+{
+	std::ifstream ifs(path);
+	if (!ifs.is_open())
+		return EResult::FileIOError;
+	return Parse(ifs);
+}
+
+minipp::EResult minipp::MiniPPFile::Schema::Parse(std::istream& input) noexcept
+{
+	MiniPPFile file;
+	auto result = file.Parse(input);
+	if (!IsResultOk(result))
+		return result;
+	return AddRules(file.GetRoot(), String());
+}
+
+minipp::EResult minipp::MiniPPFile::Schema::AddRules(const Section& section, const String& path)
+{
+	if (!path.empty())
+	{
+		auto result = AddSection(path);
+		if (result != EResult::Success)
+			return result;
+	}
+
+	for (const auto& entry : section.GetValues())
+	{
+		const Value* value = entry.second;
+		if (entry.first == "_allow_unknown")
+		{
+			if (value->GetType() != EValueType::Boolean)
+				return EResult::InvalidDataType;
+			if (static_cast<const Values::BooleanValue*>(value)->GetValue())
+				m_sections[m_sectionIds.find(path)->second].allowUnknown = true;
+			continue;
+		}
+
+		if (value->GetType() != EValueType::String)
+		{
+			PP_COUT("Schema: the rule of " << path << '.' << entry.first << " must be a string");
+			return EResult::InvalidDataType;
+		}
+		KeyRule rule;
+		auto result = ParseRule(static_cast<const Values::StringValue*>(value)->GetValue(), &rule);
+		if (result != EResult::Success)
+		{
+			PP_COUT("Schema: invalid rule for " << path << '.' << entry.first);
+			return result;
+		}
+		result = AddKey(path, entry.first, rule);
+		if (result != EResult::Success)
+			return result;
+	}
+
+	for (const auto& entry : section.GetSubSections())
+	{
+		String childPath = path;
+		if (!childPath.empty())
+			childPath += '.';
+		childPath += entry.first;
+		auto result = AddRules(*entry.second, childPath);
+		if (result != EResult::Success)
+			return result;
+	}
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::Schema::ParseRule(const String& spec, KeyRule* destination) noexcept
+{
+	String ruleText = spec;
+	String defaultText;
+	auto assignment = spec.find('=');
+	if (assignment != String::npos)
+	{
+		ruleText = spec.substr(0, assignment);
+		defaultText = spec.substr(assignment + 1);
+		Tools::StringTrim(defaultText);
+		if (defaultText.empty())
+			return EResult::ValueEmpty;
+	}
+
+	Vector<String> tokens;
+	for (auto& token : Tools::SplitByDelimiter(ruleText, ' '))
+		if (!token.empty())
+			tokens.push_back(std::move(token));
+	if (tokens.empty() || tokens.size() > 2)
+		return EResult::FormatError;
+
+	auto parseType = [](const String& name, EValueType* type)
+	{
+		if (name == "string")
+			*type = EValueType::String;
+		else if (name == "int")
+			*type = EValueType::Int;
+		else if (name == "float")
+			*type = EValueType::Float;
+		else if (name == "bool")
+			*type = EValueType::Boolean;
+		else if (name == "array")
+			*type = EValueType::Array;
+		else
+			return false;
+		return true;
+	};
+
+	KeyRule rule;
+	String& type = tokens[0];
+	if (type.back() == '?')
+	{
+		rule.required = false;
+		type.pop_back();
+	}
+	if (Tools::StringStartsWith(type, "array<") && Tools::StringEndsWith(type, ">"))
+	{
+		rule.type = EValueType::Array;
+		rule.checkElementType = true;
+		if (!parseType(type.substr(6, type.size() - 7), &rule.elementType))
+			return EResult::InvalidDataType;
+	}
+	else if (!parseType(type, &rule.type))
+		return EResult::InvalidDataType;
+
+	if (tokens.size() == 2)
+	{
+		const String& range = tokens[1];
+		auto separator = range.find("..");
+		if (separator == String::npos)
+			return EResult::FormatError;
+		String bounds[2] = { range.substr(0, separator), range.substr(separator + 2) };
+
+		for (int i = 0; i < 2; ++i)
+		{
+			if (bounds[i].empty())
+				continue;
+			const char* begin = bounds[i].c_str();
+			char* end = nullptr;
+			errno = 0;
+			switch (rule.type)
+			{
+			case EValueType::Int:
+				(i == 0 ? rule.minInt : rule.maxInt) = std::strtoll(begin, &end, 10);
+				break;
+			case EValueType::Float:
+				(i == 0 ? rule.minFloat : rule.maxFloat) = std::strtod(begin, &end);
+				break;
+			case EValueType::String:
+			case EValueType::Array:
+				if (*begin == '-')
+					return EResult::FormatError;
+				(i == 0 ? rule.minSize : rule.maxSize) = static_cast<size_t>(std::strtoull(begin, &end, 10));
+				break;
+			case EValueType::Boolean:
+				return EResult::FormatError;
+			}
+			if (errno != 0 || end != begin + bounds[i].size())
+				return EResult::FormatError;
+		}
+	}
+
+	if (!defaultText.empty())
+	{
+		EResult valueResult = EResult::Success;
+		auto value = Value::ParseValue(std::move(defaultText), &valueResult);
+		if (value == nullptr)
+			return valueResult;
+		if (CheckValue(rule, value.get()) != EResult::Success)
+			return EResult::InvalidDataType;
+		rule.defaultValue = std::move(value);
+	}
+
+	*destination = rule;
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::Schema::Validate(const Section& root) const noexcept
+{
+	auto result = ValidateSection(root, String());
+	if (result != EResult::Success)
+		return result;
+	return CheckRequired(root, nullptr);
+}
+#pragma endregion
+
+#pragma region Versioned Config
+
+namespace minipp
+{
+	namespace detail
+	{
+		// VersionedConfig and ConcurrentSection readers share values, so const access must not change them:
+		// packed and lazy arrays are unpacked (recursively) before they are published.
+		inline void MaterializeArrays(MiniPPFile::Value* value)
+		{
+			auto array = dynamic_cast<MiniPPFile::Values::ArrayValue*>(value);
+			if (array == nullptr)
+				return;
+			for (auto element : array->GetValue())
+				MaterializeArrays(element);
+		}
+	}
+}
+
+minipp::MiniPPFile::EpochDomain::Guard::~Guard()
+{
+	if (m_slot != nullptr)
+		m_slot->store(0, std::memory_order_release);
+}
+
+minipp::MiniPPFile::EpochDomain::EpochDomain(size_t readerSlots)
+	: m_readerSlots(new ReaderSlot[readerSlots != 0 ? readerSlots : 1]), m_readerSlotCount(readerSlots != 0 ? readerSlots : 1)
+{
+}
+
+minipp::MiniPPFile::EpochDomain::~EpochDomain()
+{
+	for (auto& retired : m_retired)
+		retired.deleter(retired.object);
+}
+
+minipp::MiniPPFile::EpochDomain::Guard minipp::MiniPPFile::EpochDomain::Pin() const noexcept
+{
+	// The epoch is announced (seq_cst) before the reader loads anything. Whatever is retired afterwards
+	// gets a retire epoch of at least the announced one, so Reclaim keeps it while this slot is taken.
+	size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % m_readerSlotCount;
+	while (true)
+	{
+		for (size_t i = 0; i < m_readerSlotCount; ++i)
+		{
+			std::atomic<uint64_t>& slot = m_readerSlots[(start + i) % m_readerSlotCount].epoch;
+			uint64_t expected = 0;
+			if (slot.load(std::memory_order_relaxed) == 0 && slot.compare_exchange_strong(expected, m_epoch.load()))
+				return Guard(&slot);
+		}
+		std::this_thread::yield();
+	}
+}
+
+void minipp::MiniPPFile::EpochDomain::Retire(void* object, void (*deleter)(void*))
+{
+	bool reclaim;
+	{
+		std::lock_guard<std::mutex> lock(m_retiredMutex);
+		// readers that announced an epoch up to this one may still be using object
+		m_retired.push_back({ m_epoch.fetch_add(1), object, deleter });
+		reclaim = m_retired.size() >= ReclaimThreshold;
+	}
+	if (reclaim)
+		Reclaim();
+}
+
+size_t minipp::MiniPPFile::EpochDomain::Reclaim() noexcept
+{
+	Vector<RetiredObject> reclaimable;
+	{
+		std::lock_guard<std::mutex> lock(m_retiredMutex);
+		uint64_t oldestReader = UINT64_MAX;
+		for (size_t i = 0; i < m_readerSlotCount; ++i)
+		{
+			uint64_t epoch = m_readerSlots[i].epoch.load();
+			if (epoch != 0 && epoch < oldestReader)
+				oldestReader = epoch;
+		}
+
+		size_t count = 0;
+		while (count < m_retired.size() && m_retired[count].epoch < oldestReader)
+			++count;
+		reclaimable.assign(m_retired.begin(), m_retired.begin() + count);
+		m_retired.erase(m_retired.begin(), m_retired.begin() + count);
+	}
+
+	// outside the lock, deleters may retire or reclaim themselves
+	for (auto& retired : reclaimable)
+		retired.deleter(retired.object);
+	return reclaimable.size();
+}
+
+size_t minipp::MiniPPFile::EpochDomain::GetRetiredCount() noexcept
+{
+	std::lock_guard<std::mutex> lock(m_retiredMutex);
+	return m_retired.size();
+}
+
+minipp::EResult minipp::MiniPPFile::VersionedConfig::Node::GetSubSection(const String& path, const Node** destination) const noexcept
+{
+	const Node* node = this;
+	size_t begin = 0;
+	while (begin <= path.size())
+	{
+		size_t end = path.find('.', begin);
+		if (end == String::npos)
+			end = path.size();
+
+		auto it = node->m_subSections.find(path.substr(begin, end - begin));
+		if (it == node->m_subSections.end())
+			return EResult::SectionNotPresent;
+		node = it->second.get();
+		begin = end + 1;
+	}
+
+	*destination = node;
+	return EResult::Success;
+}
+
+minipp::MiniPPFile::VersionedConfig::VersionedConfig(size_t readerSlots)
+	: m_epochs(readerSlots)
+{
+	m_current.store(new Version{ 0, std::make_shared<Node>() });
+}
+
+minipp::MiniPPFile::VersionedConfig::~VersionedConfig()
+{
+	delete m_current.load();
+}
+
+minipp::MiniPPFile::VersionedConfig::ReadGuard minipp::MiniPPFile::VersionedConfig::Read() const noexcept
+{
+	auto guard = m_epochs.Pin();
+	return ReadGuard(std::move(guard), m_current.load());
+}
+
+minipp::EResult minipp::MiniPPFile::VersionedConfig::Install(std::shared_ptr<const Node> root, uint64_t* version) noexcept
+{
+	// m_writerMutex is held
+	const Version* previous = m_current.load(std::memory_order_relaxed);
+	auto next = new Version{ previous->number + 1, std::move(root) };
+	m_current.store(next);
+
+	// dropping a version frees the nodes and values no newer version shares
+	m_epochs.Retire(previous);
+	m_epochs.Reclaim();
+
+	if (version != nullptr)
+		*version = next->number;
+	return EResult::Success;
+}
+
+size_t minipp::MiniPPFile::VersionedConfig::Reclaim() noexcept
+{
+	// freeing happens under the writer mutex only, ValuePools aren't thread-safe
+	std::lock_guard<std::mutex> lock(m_writerMutex);
+	return m_epochs.Reclaim();
+}
+
+size_t minipp::MiniPPFile::VersionedConfig::GetRetiredCount() noexcept
+{
+	return m_epochs.GetRetiredCount();
+}
+
+std::shared_ptr<const minipp::MiniPPFile::VersionedConfig::Node> minipp::MiniPPFile::VersionedConfig::Adopt(Section& section)
+{
+	// takes the values over (arrays materialized, see MaterializeArrays), the emptied Section objects are deleted by Clear
+	auto node = std::make_shared<Node>();
+	node->m_values.reserve(section.GetValues().size());
+	for (auto& pair : section.GetValues())
+	{
+		detail::MaterializeArrays(pair.second);
+		node->m_values.emplace(pair.first, std::shared_ptr<const Value>(pair.second));
+	}
+	section.GetValues().clear();
+
+	node->m_subSections.reserve(section.GetSubSections().size());
+	for (auto& pair : section.GetSubSections())
+		node->m_subSections.emplace(pair.first, Adopt(*pair.second));
+
+	node->m_comments = std::move(section.GetComments());
+	section.Clear();
+	return node;
+}
+
+template<typename Edit>
+std::shared_ptr<const minipp::MiniPPFile::VersionedConfig::Node> minipp::MiniPPFile::VersionedConfig::CopyPath(
+	const Node* node, const Vector<String>& path, size_t index, Edit& edit)
+{
+	// copies node (a shallow copy, children stay shared) and continues with the next section of path
+	auto copy = node != nullptr ? std::make_shared<Node>(*node) : std::make_shared<Node>();
+	if (index == path.size())
+	{
+		edit(*copy);
+		return copy;
+	}
+
+	const Node* child = nullptr;
+	if (node != nullptr)
+	{
+		auto it = node->m_subSections.find(path[index]);
+		if (it != node->m_subSections.end())
+			child = it->second.get();
+	}
+	copy->m_subSections[path[index]] = CopyPath(child, path, index + 1, edit);
+	return copy;
+}
+
+minipp::EResult minipp::MiniPPFile::VersionedConfig::Publish(Section&& root, uint64_t* version) noexcept
+{
+	auto node = Adopt(root);
+	std::lock_guard<std::mutex> lock(m_writerMutex);
+	return Install(std::move(node), version);
+}
+
+minipp::EResult minipp::MiniPPFile::VersionedConfig::PublishSection(const String& path, Section&& section, uint64_t* version) noexcept
+{
+	if (path.empty())
+		return EResult::EmptySectionName;
+
+	auto names = Tools::SplitByDelimiter(path, '.');
+	for (auto& name : names)
+	{
+		if (name.empty() || !Tools::IsNameValid(name) || path.back() == '.')
+		{
+			PP_COUT_SYNTAX_ERROR("Invalid section path: " << path);
+			return EResult::InvalidName;
+		}
+	}
+
+	String name = std::move(names.back());
+	names.pop_back();
+	auto node = Adopt(section);
+	auto edit = [&](Node& parent) { parent.m_subSections[name] = std::move(node); };
+
+	std::lock_guard<std::mutex> lock(m_writerMutex);
+	return Install(CopyPath(m_current.load(std::memory_order_relaxed)->root.get(), names, 0, edit), version);
+}
+
+minipp::EResult minipp::MiniPPFile::VersionedConfig::PublishValue(const String& path, std::unique_ptr<Value> value, uint64_t* version) noexcept
+{
+	if (value == nullptr)
+		return EResult::ValueEmpty;
+
+	if (path.empty() || path.back() == '.')
+		return EResult::KeyEmpty;
+
+	auto names = Tools::SplitByDelimiter(path, '.');
+	if (names.size() < 2)
+		return EResult::KeyValuePairNotInSection;
+	for (auto& name : names)
+	{
+		if (name.empty() || !Tools::IsNameValid(name))
+		{
+			PP_COUT_SYNTAX_ERROR("Invalid value path: " << path);
+			return EResult::InvalidName;
+		}
+	}
+
+	String name = std::move(names.back());
+	names.pop_back();
+	detail::MaterializeArrays(value.get());
+	std::shared_ptr<const Value> shared(value.release());
+	auto edit = [&](Node& section) { section.m_values[name] = std::move(shared); };
+
+	std::lock_guard<std::mutex> lock(m_writerMutex);
+	return Install(CopyPath(m_current.load(std::memory_order_relaxed)->root.get(), names, 0, edit), version);
+}
+
+#pragma endregion
+
+#pragma region Concurrent Section
+
+namespace minipp
+{
+	namespace detail
+	{
+		inline std::unique_ptr<MiniPPFile::Value> CloneValue(const MiniPPFile::Value* value)
+		{
+			using Values = MiniPPFile::Values;
+			switch (value->GetType())
+			{
+			case EValueType::String:
+				return std::make_unique<Values::StringValue>(static_cast<const Values::StringValue&>(*value));
+			case EValueType::Int:
+				return std::make_unique<Values::IntValue>(static_cast<const Values::IntValue&>(*value));
+			case EValueType::Float:
+				return std::make_unique<Values::FloatValue>(static_cast<const Values::FloatValue&>(*value));
+			case EValueType::Boolean:
+				return std::make_unique<Values::BooleanValue>(static_cast<const Values::BooleanValue&>(*value));
+			case EValueType::Array:
+			{
+				auto& source = static_cast<const Values::ArrayValue&>(*value);
+				auto copy = std::make_unique<Values::ArrayValue>();
+				copy->GetComments() = source.GetComments();
+				copy->GetValue().reserve(source.GetValue().size());
+				for (auto element : source.GetValue())
+					copy->GetValue().push_back(CloneValue(element).release());
+				return copy;
 			}
-			++i;
+			}
+			return nullptr;
 		}
-		else if (str[i] == '"')
-			return EResult::UnescapedStringValue;
-		else
-			m_value.push_back(str[i]);
 	}
+}
+
+minipp::MiniPPFile::ConcurrentSection::ConcurrentSection(size_t shardCount, size_t readerSlots)
+	: ConcurrentSection(new EpochDomain(readerSlots), shardCount)
+{
+	m_ownedEpochs.reset(m_epochs);
+}
+
+minipp::MiniPPFile::ConcurrentSection::ConcurrentSection(EpochDomain* epochs, size_t shardCount)
+	: m_epochs(epochs), m_shards(new Shard[shardCount != 0 ? shardCount : 1]), m_shardCount(shardCount != 0 ? shardCount : 1)
+{
+	for (size_t i = 0; i < m_shardCount; ++i)
+		m_shards[i].values.store(new ValueMap(), std::memory_order_relaxed);
+	m_subSections.store(new SubSectionMap());
+}
+
+minipp::MiniPPFile::ConcurrentSection::~ConcurrentSection()
+{
+	for (size_t i = 0; i < m_shardCount; ++i)
+	{
+		const ValueMap* values = m_shards[i].values.load();
+		for (auto& pair : *values)
+			delete pair.second;
+		delete values;
+	}
+
+	const SubSectionMap* subSections = m_subSections.load();
+	for (auto& pair : *subSections)
+		delete pair.second;
+	delete subSections;
+	// m_ownedEpochs goes last, it frees what was retired (removed sub-sections of this tree among it)
+}
+
+minipp::MiniPPFile::ConcurrentSection::Shard& minipp::MiniPPFile::ConcurrentSection::GetShard(const String& name) const noexcept
+{
+	return m_shards[std::hash<String>()(name) % m_shardCount];
+}
+
+const minipp::MiniPPFile::Value* minipp::MiniPPFile::ConcurrentSection::FindValue(const String& key) const noexcept
+{
+	const ValueMap* values = GetShard(key).values.load();
+	auto it = values->find(key);
+	return it != values->end() ? it->second : nullptr;
+}
+
+const minipp::MiniPPFile::ConcurrentSection* minipp::MiniPPFile::ConcurrentSection::FindSubSection(const String& name) const noexcept
+{
+	const SubSectionMap* subSections = m_subSections.load();
+	auto it = subSections->find(name);
+	return it != subSections->end() ? it->second : nullptr;
+}
+
+minipp::EResult minipp::MiniPPFile::ConcurrentSection::GetSubSection(const ReadGuard& guard, const String& path, const ConcurrentSection** destination) const noexcept
+{
+	(void)guard; // proves that the tree is pinned
+
+	const ConcurrentSection* section = this;
+	size_t begin = 0;
+	while (begin <= path.size())
+	{
+		size_t end = path.find('.', begin);
+		if (end == String::npos)
+			end = path.size();
+
+		section = section->FindSubSection(path.substr(begin, end - begin));
+		if (section == nullptr)
+			return EResult::SectionNotPresent;
+		begin = end + 1;
+	}
+
+	*destination = section;
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::ConcurrentSection::SetValue(const String& name, std::unique_ptr<Value> value, bool allowOverwrite) noexcept
+{
+	if (value == nullptr)
+		return EResult::ValueEmpty;
+	if (name.empty())
+		return EResult::KeyEmpty;
+	if (!Tools::IsNameValid(name))
+		return EResult::InvalidName;
+	detail::MaterializeArrays(value.get());
+
+	Shard& shard = GetShard(name);
+	std::lock_guard<std::mutex> lock(shard.writerMutex);
+	const ValueMap* current = shard.values.load(std::memory_order_relaxed);
+	auto it = current->find(name);
+	const Value* previous = it != current->end() ? it->second : nullptr;
+	if (previous != nullptr && !allowOverwrite)
+		return EResult::KeyAlreadyPresent;
+
+	auto next = new ValueMap(*current);
+	(*next)[name] = value.release();
+	shard.values.store(next);
+
+	m_epochs->Retire(current);
+	if (previous == nullptr)
+		return EResult::Success;
+	m_epochs->Retire(previous);
+	return EResult::ValueOverwritten;
+}
+
+minipp::EResult minipp::MiniPPFile::ConcurrentSection::RemoveValue(const String& name) noexcept
+{
+	Shard& shard = GetShard(name);
+	std::lock_guard<std::mutex> lock(shard.writerMutex);
+	const ValueMap* current = shard.values.load(std::memory_order_relaxed);
+	auto it = current->find(name);
+	if (it == current->end())
+		return EResult::KeyNotPresent;
+
+	const Value* previous = it->second;
+	auto next = new ValueMap(*current);
+	next->erase(name);
+	shard.values.store(next);
+
+	m_epochs->Retire(current);
+	m_epochs->Retire(previous);
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::ConcurrentSection::EmplaceSubSection(const String& name, ConcurrentSection** destination) noexcept
+{
+	if (name.empty())
+		return EResult::EmptySectionName;
+	if (!Tools::IsNameValid(name))
+		return EResult::InvalidName;
+
+	std::lock_guard<std::mutex> lock(m_subSectionMutex);
+	const SubSectionMap* current = m_subSections.load(std::memory_order_relaxed);
+	auto it = current->find(name);
+	if (it != current->end())
+	{
+		if (destination != nullptr)
+			*destination = it->second;
+		return EResult::SectionAlreadyPresent;
+	}
+
+	auto section = new ConcurrentSection(m_epochs, m_shardCount);
+	auto next = new SubSectionMap(*current);
+	next->emplace(name, section);
+	m_subSections.store(next);
+	m_epochs->Retire(current);
+
+	if (destination != nullptr)
+		*destination = section;
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::ConcurrentSection::RemoveSubSection(const String& name) noexcept
+{
+	std::lock_guard<std::mutex> lock(m_subSectionMutex);
+	const SubSectionMap* current = m_subSections.load(std::memory_order_relaxed);
+	auto it = current->find(name);
+	if (it == current->end())
+		return EResult::SectionNotPresent;
+
+	const ConcurrentSection* section = it->second;
+	auto next = new SubSectionMap(*current);
+	next->erase(name);
+	m_subSections.store(next);
+
+	m_epochs->Retire(current);
+	m_epochs->Retire(section);
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::ConcurrentSection::Load(Section&& section) noexcept
+{
+	EResult result = EResult::Success;
+
+	// one copy per shard instead of one per value
+	Vector<Vector<std::pair<const String*, Value*>>> shardValues(m_shardCount);
+	for (auto& pair : section.GetValues())
+	{
+		if (pair.first.empty() || !Tools::IsNameValid(pair.first))
+		{
+			result = pair.first.empty() ? EResult::KeyEmpty : EResult::InvalidName;
+			continue;
+		}
+		detail::MaterializeArrays(pair.second);
+		shardValues[std::hash<String>()(pair.first) % m_shardCount].emplace_back(&pair.first, pair.second);
+		pair.second = nullptr;
+	}
+
+	for (size_t i = 0; i < m_shardCount; ++i)
+	{
+		if (shardValues[i].empty())
+			continue;
+
+		Shard& shard = m_shards[i];
+		std::lock_guard<std::mutex> lock(shard.writerMutex);
+		const ValueMap* current = shard.values.load(std::memory_order_relaxed);
+		auto next = new ValueMap(*current);
+		Vector<const Value*> replaced;
+		for (auto& pair : shardValues[i])
+		{
+			auto& slot = (*next)[*pair.first];
+			if (slot != nullptr)
+				replaced.push_back(slot);
+			slot = pair.second;
+		}
+		shard.values.store(next);
+
+		m_epochs->Retire(current);
+		for (auto value : replaced)
+			m_epochs->Retire(value);
+	}
+
+	for (auto& pair : section.GetSubSections())
+	{
+		ConcurrentSection* subSection = nullptr;
+		auto subResult = EmplaceSubSection(pair.first, &subSection);
+		if (subSection != nullptr)
+			subResult = subSection->Load(std::move(*pair.second));
+		if (!IsResultOk(subResult))
+			result = subResult;
+	}
+
+	section.Clear();
+	return result;
+}
+
+minipp::EResult minipp::MiniPPFile::ConcurrentSection::CopyTo(Section& destination) const noexcept
+{
+	auto guard = Read();
+	return CopyPinned(destination);
+}
+
+minipp::EResult minipp::MiniPPFile::ConcurrentSection::CopyPinned(Section& destination) const noexcept
+{
+	for (size_t i = 0; i < m_shardCount; ++i)
+	{
+		const ValueMap* values = m_shards[i].values.load();
+		for (auto& pair : *values)
+		{
+			auto result = destination.SetValue(pair.first, detail::CloneValue(pair.second), true);
+			if (!IsResultOk(result))
+				return result;
+		}
+	}
+
+	const SubSectionMap* subSections = m_subSections.load();
+	for (auto& pair : *subSections)
+	{
+		Section* subSection = nullptr;
+		destination.EmplaceSubSection(pair.first, &subSection);
+		auto result = pair.second->CopyPinned(*subSection);
+		if (!IsResultOk(result))
+			return result;
+	}
+	return EResult::Success;
+}
+
+#pragma endregion
+
+#pragma region Defaults
+minipp::EResult minipp::MiniPPFile::Defaults::Add(const String& path, std::shared_ptr<const Value> value, bool allowOverwrite)
+{
+	if (value == nullptr)
+		return EResult::ValueEmpty;
+	if (Tools::FirstIndexOf(path, '.') == -1)
+		return EResult::KeyValuePairNotInSection;
+
+	auto inserted = m_ids.emplace(path, static_cast<Id>(m_values.size()));
+	if (!inserted.second)
+	{
+		if (!allowOverwrite)
+			return EResult::KeyAlreadyPresent;
+		m_values[inserted.first->second] = std::move(value);
+		return EResult::ValueOverwritten;
+	}
+	m_paths.push_back(path);
+	m_values.push_back(std::move(value));
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::Defaults::Load(const Section& root)
+{
+	// (section, path) pairs still to visit
+	Vector<std::pair<const Section*, String>> pending;
+	pending.emplace_back(&root, String());
+	while (!pending.empty())
+	{
+		auto current = std::move(pending.back());
+		pending.pop_back();
+
+		for (const auto& entry : current.first->GetValues())
+		{
+			// values of the root are rejected by Add
+			auto path = current.second.empty() ? entry.first : current.second + '.' + entry.first;
+			auto result = Add(path, std::shared_ptr<const Value>(detail::CloneValue(entry.second)), true);
+			if (!IsResultOk(result))
+				return result;
+		}
+		for (const auto& entry : current.first->GetSubSections())
+			pending.emplace_back(entry.second, current.second.empty() ? entry.first : current.second + '.' + entry.first);
+	}
+	return EResult::Success;
+}
 
+minipp::EResult minipp::MiniPPFile::Defaults::Load(const Schema& schema)
+{
+	for (const auto& section : schema.m_sections)
+	{
+		for (size_t key = 0; key < section.keys.size(); ++key)
+		{
+			if (section.keys[key].defaultValue == nullptr)
+				continue;
+			auto result = Add(section.path + '.' + section.keyNames[key], section.keys[key].defaultValue, true);
+			if (!IsResultOk(result))
+				return result;
+		}
+	}
 	return EResult::Success;
 }
 
-minipp::EResult minipp::MiniPPFile::Values::StringValue::ToString(std::string& destination) const noexcept
+minipp::EResult minipp::MiniPPFile::Defaults::Parse(const std::string& path) noexcept
 {
-	std::string sanitizedValue = m_value;
+	std::ifstream ifs(path);
+	if (!ifs.is_open())
+		return EResult::FileIOError;
+	return Parse(ifs);
+}
+
+minipp::EResult minipp::MiniPPFile::Defaults::Parse(std::istream& input) noexcept
+{
+	MiniPPFile file;
+	auto result = file.Parse(input);
+	if (!IsResultOk(result))
+		return result;
+	return Load(file.GetRoot());
+}
+#pragma endregion
 
-	for (size_t i = 0; i < sanitizedValue.size(); ++i)
+#pragma region Source Map
+void minipp::MiniPPFile::SourceMap::Record(const void* node, const SourcePosition& position)
+{
+	auto inserted = m_ids.emplace(node, static_cast<Id>(m_positions.size()));
+	if (!inserted.second)
 	{
-		switch (sanitizedValue[i])
-		{
-		case '\n':
-			sanitizedValue.replace(i, 1, "\\n");
-			i++;
-			break;
-		case '\t':
-			sanitizedValue.replace(i, 1, "\\t");
-			i++;
-			break;
-		case '\r':
-			sanitizedValue.replace(i, 1, "\\r");
-			i++;
-			break;
-		case '\\':
-			sanitizedValue.insert(i, 1, '\\');
-			i++;
-			break;
-		case '\"':
-			sanitizedValue.insert(i, 1, '\\');
-			i++;
-			break;
-		default: break;
-		}
+		// a node of an earlier parse was freed and its address reused
+		m_positions[inserted.first->second] = position;
+		return;
 	}
+	m_positions.push_back(position);
+}
+
+void minipp::MiniPPFile::SourceMap::Clear() noexcept
+{
+	m_ids.clear();
+	m_positions.clear();
+}
+#pragma endregion
+
+#pragma region Overrides
+std::unique_ptr<minipp::MiniPPFile::Value> minipp::MiniPPFile::Overrides::ParseEntry(uint32_t id, EResult* result) const
+{
+	auto value = Value::ParseValue(m_entries[id].text, result);
+	if (value == nullptr)
+		PP_COUT("Invalid override of " << m_entries[id].sectionPath << '.' << m_entries[id].key << ": " << m_entries[id].text);
+	return value;
+}
+
+const minipp::HashMap<minipp::String, uint32_t>* minipp::MiniPPFile::Overrides::FindSection(const String& path) const noexcept
+{
+	auto it = m_sections.find(path);
+	return it != m_sections.end() ? &it->second : nullptr;
+}
+
+minipp::EResult minipp::MiniPPFile::Overrides::SplitPath(const String& path, String& section, String& key)
+{
+	int64_t separator = Tools::LastIndexOf(path, '.');
+	if (separator == -1)
+		return EResult::KeyValuePairNotInSection;
+	auto parts = Tools::SplitInTwo(path, separator);
+	if (parts.second.empty() || !Tools::IsNameValid(parts.second))
+		return EResult::InvalidName;
+	if (parts.first.empty() || parts.first.back() == '.')
+		return EResult::InvalidName;
+	for (const auto& name : Tools::SplitByDelimiter(parts.first, '.'))
+		if (name.empty() || !Tools::IsNameValid(name))
+			return EResult::InvalidName;
 
-	destination = "\"" + sanitizedValue + "\"";
+	section = std::move(parts.first);
+	key = std::move(parts.second);
 	return EResult::Success;
 }
 
-minipp::EResult minipp::MiniPPFile::Values::IntValue::Parse(const std::string& str) noexcept
+minipp::EResult minipp::MiniPPFile::Overrides::Add(const String& path, const String& value)
 {
-	std::string sanitizedValue = str;
-	Tools::RemoveAll(sanitizedValue, '_');
-	if (sanitizedValue.empty())
+	String section;
+	String key;
+	EResult result = SplitPath(path, section, key);
+	if (!IsResultOk(result))
+		return result;
+
+	String text = value;
+	Tools::StringTrim(text);
+	if (text.empty())
+		return EResult::ValueEmpty;
+	if (Value::ParseValue(text, &result) == nullptr)
+		return result;
+
+	auto& keys = m_sections[section];
+	auto inserted = keys.emplace(key, static_cast<uint32_t>(m_entries.size()));
+	if (!inserted.second)
 	{
-		PP_COUT_SYNTAX_ERROR("Empty string for integer value.");
-		return EResult::FormatError;
+		m_entries[inserted.first->second].text = std::move(text);
+		return EResult::ValueOverwritten;
 	}
+	m_entries.push_back(Entry{ std::move(section), std::move(key), std::move(text) });
+	return EResult::Success;
+}
 
-	char lastCharacter = str.back();
-	auto rest = str.substr(0, str.size() - 1);
-	try
+minipp::EResult minipp::MiniPPFile::Overrides::AddAssignment(const String& assignment)
+{
+	int64_t separator = Tools::FirstIndexOf(assignment, '=');
+	if (separator == -1)
+		return EResult::ExpectedKeyValuePair;
+	auto parts = Tools::SplitInTwo(assignment, separator);
+	Tools::StringTrim(parts.first);
+	return Add(parts.first, parts.second);
+}
+
+minipp::EResult minipp::MiniPPFile::Overrides::AddFromEnvironment(const String& prefix)
+{
+	EResult firstError = EResult::Success;
+	for (char** variable = MINIPP_ENVIRONMENT; variable != nullptr && *variable != nullptr; ++variable)
 	{
-		if (lastCharacter == 'h')
+		const char* text = *variable;
+		if (std::strncmp(text, prefix.c_str(), prefix.size()) != 0)
+			continue;
+		const char* assignment = std::strchr(text, '=');
+		if (assignment == nullptr)
+			continue;
+
+		String path;
+		for (const char* c = text + prefix.size(); c != assignment; ++c)
 		{
-			m_value = std::stoll(rest, nullptr, 16);
-			m_style = EIntStyle::Hexadecimal;
+			if (c[0] == '_' && c + 1 != assignment && c[1] == '_')
+			{
+				path += '.';
+				++c;
+			}
+			else
+				path += *c;
 		}
-		else if (lastCharacter == 'b')
+
+		// other tools share the prefix, so names that aren't a section.key path are none of our business
+		String section;
+		String key;
+		if (!IsResultOk(SplitPath(path, section, key)))
 		{
-			m_value = std::stoll(rest, nullptr, 2);
-			m_style = EIntStyle::Binary;
+			PP_COUT("Skipping environment variable " << String(text, assignment) << ", not a section.key path");
+			continue;
 		}
-		else
+
+		auto result = Add(path, String(assignment + 1));
+		if (!IsResultOk(result))
 		{
-			if (!Tools::IsIntegerDecimal(sanitizedValue))
-			{
-				PP_COUT_SYNTAX_ERROR("Invalid decimal integer value: " << sanitizedValue);
-				return EResult::IntegerValueInvalid;
-			}
-			m_value = std::stoll(sanitizedValue);
-			m_style = EIntStyle::Decimal;
+			PP_COUT("Invalid override in environment variable " << String(text, assignment));
+			if (IsResultOk(firstError))
+				firstError = result;
 		}
 	}
-	catch (const std::invalid_argument&)
-	{
-		PP_COUT_SYNTAX_ERROR("Invalid integer value: " << sanitizedValue);
-		return EResult::IntegerValueInvalid;
-	}
-	catch (const std::out_of_range&)
-	{
-		PP_COUT_SYNTAX_ERROR("Integer value out of range: " << sanitizedValue);
-		return EResult::IntegerValueOutOfRange;
-	}
-
-	return EResult::Success;
+	return firstError;
 }
+#pragma endregion
+
+#pragma region JSON Import
 
-minipp::EResult minipp::MiniPPFile::Values::IntValue::ToString(std::string& destination) const noexcept
+class minipp::MiniPPFile::JsonReader
 {
-	switch (m_style)
+private:
+	static constexpr size_t MaxDepth = 512; // objects and arrays are parsed recursively
+
+	std::istream& m_input;
+	Vector<char> m_buffer;
+	size_t m_position = 0;
+	size_t m_size = 0;
+	int64_t m_line = 1;
+	String m_string; // text of the current string / number / literal
+
+public:
+	explicit JsonReader(std::istream& input) : m_input(input), m_buffer(64 * 1024) {}
+
+	template<typename Handler>
+	EResult ParseDocument(Handler& handler) noexcept;
+
+private:
+	template<typename Handler>
+	EResult ParseMembers(Handler& handler, size_t depth) noexcept;
+	template<typename Handler>
+	EResult ParseElements(Handler& handler, size_t depth) noexcept;
+	template<typename Handler>
+	EResult ParseScalar(Handler& handler, const String* name) noexcept;
+
+	EResult ReadString() noexcept;
+	EResult ReadUnicodeEscape() noexcept;
+	EResult ReadHexQuad(uint32_t& destination) noexcept;
+	void ReadToken() noexcept;
+	EResult CheckName(const String& name) const noexcept;
+
+	bool Refill() noexcept
 	{
-	case EIntStyle::Decimal:
-	{
-		destination = std::to_string(m_value);
-		break;
+		if (!m_input)
+			return false;
+		m_input.read(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+		m_position = 0;
+		m_size = static_cast<size_t>(m_input.gcount());
+		return m_size != 0;
 	}
-	case EIntStyle::Hexadecimal:
+
+	int Peek() noexcept
 	{
-		std::stringstream ss;
-		ss << std::hex << m_value << "h";
-		destination = ss.str();
-		break;
+		if (m_position == m_size && !Refill())
+			return -1;
+		return static_cast<unsigned char>(m_buffer[m_position]);
 	}
-	case EIntStyle::Binary:
-	{
-		std::bitset<64> bs(m_value);
-		destination = bs.to_string() + "b";
 
-		size_t i;
-		for (i = 0; i < destination.size(); ++i) // cut of leading zeros
-			if (destination[i] == '1')
-			{
-				destination = destination.substr(i);
-				break;
-			}
-		if (i == destination.size()) // we dont wan't 64 zeros for a 0 value
-			destination = "0b";
-		break;
-	}
-	default:
-		PP_COUT_SYNTAX_ERROR("Invalid integer style.");
-		return EResult::IntegerStyleInvalid;
+	int Next() noexcept
+	{
+		int c = Peek();
+		if (c >= 0)
+			++m_position;
+		return c;
 	}
 
-	return EResult::Success;
-}
+	void SkipWhitespace() noexcept
+	{
+		while (true)
+		{
+			int c = Peek();
+			if (c == '\n')
+				++m_line;
+			else if (c != ' ' && c != '\t' && c != '\r')
+				return;
+			++m_position;
+		}
+	}
+};
 
-minipp::EResult minipp::MiniPPFile::Values::BooleanValue::Parse(const std::string& str) noexcept
+template<typename Handler>
+minipp::EResult minipp::MiniPPFile::JsonReader::ParseDocument(Handler& handler) noexcept
 {
-	if (str == "true")
-		m_value = true;
-	else if (str == "false")
-		m_value = false;
-	else
+	SkipWhitespace();
+	if (Next() != '{')
 	{
-		PP_COUT_SYNTAX_ERROR("Invalid boolean value: " << str << " (may only contain lowercase true and false)");
-		return EResult::BooleanValueInvalid;
+		PP_COUT_SYNTAX_ERROR_LINE(m_line, "Expected a JSON object at the start of the document.");
+		return EResult::FormatError;
 	}
-	return EResult::Success;
-}
 
-minipp::EResult minipp::MiniPPFile::Values::BooleanValue::ToString(std::string& destination) const noexcept
-{
-	destination = m_value ? "true" : "false";
+	auto result = ParseMembers(handler, 0);
+	if (!IsResultOk(result))
+		return result;
+
+	SkipWhitespace();
+	if (Peek() != -1)
+	{
+		PP_COUT_SYNTAX_ERROR_LINE(m_line, "Unexpected content after the JSON object.");
+		return EResult::FormatError;
+	}
 	return EResult::Success;
 }
 
-minipp::EResult minipp::MiniPPFile::Values::FloatValue::Parse(const std::string& str) noexcept
+template<typename Handler>
+minipp::EResult minipp::MiniPPFile::JsonReader::ParseMembers(Handler& handler, size_t depth) noexcept
 {
-	try
+	// the opening '{' is consumed already, depth 0 is the top-level object
+	if (depth > MaxDepth)
 	{
-		m_value = std::stod(str);
+		PP_COUT_SYNTAX_ERROR_LINE(m_line, "JSON nested deeper than " << MaxDepth << " levels.");
+		return EResult::FormatError;
 	}
-	catch (...)
+
+	SkipWhitespace();
+	if (Peek() == '}')
 	{
-		PP_COUT_SYNTAX_ERROR("Invalid float value: " << str);
-		return EResult::FloatValueInvalid;
+		++m_position;
+		return EResult::Success;
 	}
 
-	return EResult::Success;
-}
+	String name;
+	while (true)
+	{
+		SkipWhitespace();
+		if (Next() != '"')
+		{
+			PP_COUT_SYNTAX_ERROR_LINE(m_line, "Expected '\"' at the start of a member name.");
+			return EResult::FormatError;
+		}
+		auto result = ReadString();
+		if (!IsResultOk(result))
+			return result;
+		name.swap(m_string);
 
-minipp::EResult minipp::MiniPPFile::Values::FloatValue::ToString(std::string& destination) const noexcept
-{
-	destination = std::to_string(m_value) + "f";
-	return EResult::Success;
-}
+		result = CheckName(name);
+		if (!IsResultOk(result))
+			return result;
 
-minipp::MiniPPFile::Values::ArrayValue::~ArrayValue()
-{
-	for (auto& val : m_values)
-		delete val;
+		SkipWhitespace();
+		if (Next() != ':')
+		{
+			PP_COUT_SYNTAX_ERROR_LINE(m_line, "Expected ':' after member \"" << name << "\".");
+			return EResult::FormatError;
+		}
+		SkipWhitespace();
+
+		int c = Peek();
+		if (c == '{')
+		{
+			++m_position;
+			result = handler.OnBeginSection(name);
+			if (IsResultOk(result))
+				result = ParseMembers(handler, depth + 1);
+			if (IsResultOk(result))
+				result = handler.OnEndSection();
+		}
+		else if (depth == 0)
+		{
+			PP_COUT_SYNTAX_ERROR_LINE(m_line, "Member \"" << name << "\" of the top-level object is not an object, mini values need a section.");
+			return EResult::KeyValuePairNotInSection;
+		}
+		else if (c == '[')
+		{
+			++m_position;
+			result = handler.OnBeginArray(&name);
+			if (IsResultOk(result))
+				result = ParseElements(handler, depth + 1);
+		}
+		else
+			result = ParseScalar(handler, &name);
+
+		if (!IsResultOk(result))
+			return result;
+
+		SkipWhitespace();
+		c = Next();
+		if (c == '}')
+			return EResult::Success;
+		if (c != ',')
+		{
+			PP_COUT_SYNTAX_ERROR_LINE(m_line, "Expected ',' or '}' after member \"" << name << "\".");
+			return EResult::FormatError;
+		}
+	}
 }
 
-minipp::EResult minipp::MiniPPFile::Values::ArrayValue::Parse(const std::string& str) noexcept
+template<typename Handler>
+minipp::EResult minipp::MiniPPFile::JsonReader::ParseElements(Handler& handler, size_t depth) noexcept
 {
-	if (str.front() != '[' || str.back() != ']')
+	// the opening '[' is consumed already
+	if (depth > MaxDepth)
 	{
-		PP_COUT_SYNTAX_ERROR("Array value must be enclosed in [] brackets.");
+		PP_COUT_SYNTAX_ERROR_LINE(m_line, "JSON nested deeper than " << MaxDepth << " levels.");
 		return EResult::FormatError;
 	}
 
-	int64_t bracketCounter = 0;
-	bool isInString = false; // we may encounter array value separators "," inside strings; we need to ignore those
-
-	std::vector<std::string> elements;
-	std::string currentElement;
-
-	for (size_t i = 0; i < str.size(); ++i)
+	SkipWhitespace();
+	if (Peek() == ']')
 	{
-		char c = str[i];
+		++m_position;
+		return handler.OnEndArray();
+	}
 
-		if (isInString)
+	while (true)
+	{
+		SkipWhitespace();
+		int c = Peek();
+		EResult result;
+		if (c == '{')
 		{
-			if (c == '\\')
-			{
-				if (i + 1 >= str.size())
-				{
-					PP_COUT_SYNTAX_ERROR("Bad escape sequence: '\\' at end of string");
-					return EResult::BadEscapeSequence;
-				}
-				currentElement += c;
-				currentElement += str[i + 1];
-				++i;
-			}
-			else if (c == '"')
-			{
-				isInString = false;
-				currentElement += c;
-			}
-			else
-				currentElement += c;
+			PP_COUT_SYNTAX_ERROR_LINE(m_line, "Objects inside arrays have no mini equivalent.");
+			return EResult::InvalidDataType;
 		}
-		else if (c == '\\')
-			++i;
-		else if (c == '"')
+
+		if (c == '[')
 		{
-			currentElement += c;
-			isInString = true;
+			++m_position;
+			result = handler.OnBeginArray(nullptr);
 		}
 		else
+			result = ParseScalar(handler, nullptr);
+
+		if (result == EResult::ArrayDataTypeInconsistency)
+			PP_COUT_SYNTAX_ERROR_LINE(m_line, "Array elements must all have the same type.");
+		if (IsResultOk(result) && c == '[')
+			result = ParseElements(handler, depth + 1);
+		if (!IsResultOk(result))
+			return result;
+
+		SkipWhitespace();
+		c = Next();
+		if (c == ']')
+			return handler.OnEndArray();
+		if (c != ',')
 		{
-			if (c == '[')
-			{
-				if (++bracketCounter > 1)
-					currentElement += c;
-			}
-			else if (c == ']')
-			{
-				--bracketCounter;
-				if (bracketCounter < 0)
-				{
-					PP_COUT_SYNTAX_ERROR("Array brackets are not balanced. (One ] too much or encountered too early)");
-					return EResult::ArrayBracketsInbalanced;
-				}
-				else if (bracketCounter >= 1)
-					currentElement += c;
-			}
-			else if (c == ',' && bracketCounter == 1)
-			{
-				elements.push_back(currentElement);
-				currentElement = "";
-			}
-			else if (c != ' ' && c != '\t')
-				currentElement += c;
+			PP_COUT_SYNTAX_ERROR_LINE(m_line, "Expected ',' or ']' in array.");
+			return EResult::FormatError;
 		}
 	}
+}
 
-	if (bracketCounter != 0) // will always be a positive value because negative values are caught earlier
+template<typename Handler>
+minipp::EResult minipp::MiniPPFile::JsonReader::ParseScalar(Handler& handler, const String* name) noexcept
+{
+	// name is nullptr for array elements
+	int c = Peek();
+	if (c == '"')
 	{
-		PP_COUT_SYNTAX_ERROR("Array brackets are not balanced. (Missing " << bracketCounter << " closing brackets)");
-		return EResult::ArrayBracketsInbalanced;
+		++m_position;
+		auto result = ReadString();
+		if (!IsResultOk(result))
+			return result;
+		return handler.OnString(name, m_string);
 	}
 
-	if (!currentElement.empty())
-		elements.push_back(currentElement);
-	size_t lastTypeIdHash = 0;
-	bool hasTypeHash = false;
+	ReadToken();
+	if (m_string == "true" || m_string == "false")
+		return handler.OnBoolean(name, m_string[0] == 't');
+	if (m_string == "null")
+	{
+		if (name != nullptr)
+			return EResult::Success;
+		PP_COUT_SYNTAX_ERROR_LINE(m_line, "null array elements have no mini equivalent.");
+		return EResult::InvalidDataType;
+	}
 
-	EResult result;
-	for (auto& elem : elements)
+	if (m_string.empty() || (m_string[0] != '-' && (m_string[0] < '0' || m_string[0] > '9')))
 	{
-		auto parsed = ParseValue(elem, &result);
-		if (parsed == nullptr)
-			return result;
+		PP_COUT_SYNTAX_ERROR_LINE(m_line, "Unexpected JSON value: " << (m_string.empty() ? String(1, static_cast<char>(c)) : m_string));
+		return EResult::FormatError;
+	}
+
+	const char* begin = m_string.c_str();
+	char* end = nullptr;
+	if (m_string.find_first_of(".eE") == String::npos)
+	{
+		errno = 0;
+		long long value = std::strtoll(begin, &end, 10);
+		if (end == begin + m_string.size() && errno != ERANGE)
+			return handler.OnInt(name, static_cast<int64_t>(value));
+		// integers beyond int64_t fall through and become floats
+	}
+
+	double value = std::strtod(begin, &end);
+	if (end != begin + m_string.size())
+	{
+		PP_COUT_SYNTAX_ERROR_LINE(m_line, "Invalid JSON number: " << m_string);
+		return EResult::FloatValueInvalid;
+	}
+	return handler.OnFloat(name, value);
+}
+
+minipp::EResult minipp::MiniPPFile::JsonReader::ReadString() noexcept
+{
+	// the opening '"' is consumed already
+	static const char specialChars[] = { '"', '\\' };
 
-		if (!hasTypeHash)
+	m_string.clear();
+	while (true)
+	{
+		if (m_position == m_size && !Refill())
 		{
-			lastTypeIdHash = typeid(*parsed).hash_code();
-			hasTypeHash = true;
+			PP_COUT_SYNTAX_ERROR_LINE(m_line, "Unterminated JSON string.");
+			return EResult::MissingQuote;
 		}
-		else if (typeid(*parsed).hash_code() != lastTypeIdHash)
-			return EResult::ArrayDataTypeInconsistency;
 
-		m_values.push_back(parsed.release());
+		const char* data = m_buffer.data() + m_position;
+		size_t size = m_size - m_position;
+		size_t next = Tools::FindFirstOf(data, size, specialChars, sizeof(specialChars));
+		m_string.append(data, next);
+		m_position += next;
+		if (next == size)
+			continue;
+
+		++m_position;
+		if (data[next] == '"')
+			return EResult::Success;
+
+		int escaped = Next();
+		switch (escaped)
+		{
+		case '"': m_string += '"'; break;
+		case '\\': m_string += '\\'; break;
+		case '/': m_string += '/'; break;
+		case 'b': m_string += '\b'; break;
+		case 'f': m_string += '\f'; break;
+		case 'n': m_string += '\n'; break;
+		case 'r': m_string += '\r'; break;
+		case 't': m_string += '\t'; break;
+		case 'u':
+		{
+			auto result = ReadUnicodeEscape();
+			if (!IsResultOk(result))
+				return result;
+			break;
+		}
+		case -1:
+			PP_COUT_SYNTAX_ERROR_LINE(m_line, "'\\' at end of JSON input.");
+			return EResult::BadEscapeSequence;
+		default:
+			PP_COUT_SYNTAX_ERROR_LINE(m_line, "Unknown escape sequence '\\" << static_cast<char>(escaped) << "'");
+			return EResult::UnknownEscapeSequence;
+		}
 	}
+}
 
+minipp::EResult minipp::MiniPPFile::JsonReader::ReadHexQuad(uint32_t& destination) noexcept
+{
+	destination = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		int c = Next();
+		uint32_t digit;
+		if (c >= '0' && c <= '9')
+			digit = static_cast<uint32_t>(c - '0');
+		else if (c >= 'a' && c <= 'f')
+			digit = static_cast<uint32_t>(c - 'a' + 10);
+		else if (c >= 'A' && c <= 'F')
+			digit = static_cast<uint32_t>(c - 'A' + 10);
+		else
+		{
+			PP_COUT_SYNTAX_ERROR_LINE(m_line, "Expected four hex digits after '\\u'.");
+			return EResult::BadEscapeSequence;
+		}
+		destination = destination * 16 + digit;
+	}
 	return EResult::Success;
 }
 
-minipp::EResult minipp::MiniPPFile::Values::ArrayValue::ToString(std::string& destination) const noexcept
+minipp::EResult minipp::MiniPPFile::JsonReader::ReadUnicodeEscape() noexcept
 {
-	std::string buf;
-	size_t lastTypeIdHash = 0;
-	bool hasTypeHash = false;
+	// '\u' is consumed already; appends the code point as UTF-8, surrogate pairs are combined
+	uint32_t codePoint;
+	auto result = ReadHexQuad(codePoint);
+	if (!IsResultOk(result))
+		return result;
 
-	std::stringstream ss;
-	for (const auto& val : m_values)
+	if (codePoint >= 0xD800 && codePoint <= 0xDBFF)
 	{
-		EResult result = val->ToString(buf);
-		if (!IsResultOk(result))
-			return result;
-
-		if (!hasTypeHash)
+		uint32_t low = 0;
+		if (Next() != '\\' || Next() != 'u' || !IsResultOk(ReadHexQuad(low)) || low < 0xDC00 || low > 0xDFFF)
 		{
-			lastTypeIdHash = typeid(*val).hash_code();
-			hasTypeHash = true;
+			PP_COUT_SYNTAX_ERROR_LINE(m_line, "Unpaired surrogate in '\\u' escape.");
+			return EResult::BadEscapeSequence;
 		}
-		else if (typeid(*val).hash_code() != lastTypeIdHash)
-			return EResult::ArrayDataTypeInconsistency;
-
-		ss << buf << ", ";
+		codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+	}
+	else if (codePoint >= 0xDC00 && codePoint <= 0xDFFF)
+	{
+		PP_COUT_SYNTAX_ERROR_LINE(m_line, "Unpaired surrogate in '\\u' escape.");
+		return EResult::BadEscapeSequence;
 	}
-	std::string valueString = ss.str();
-	if (!valueString.empty()) // remove the last ", " if there are any elements
-		valueString = valueString.substr(0, valueString.size() - 2);
-
-	destination = "[" + valueString + "]";
 
+	if (codePoint < 0x80)
+		m_string += static_cast<char>(codePoint);
+	else if (codePoint < 0x800)
+	{
+		m_string += static_cast<char>(0xC0 | (codePoint >> 6));
+		m_string += static_cast<char>(0x80 | (codePoint & 0x3F));
+	}
+	else if (codePoint < 0x10000)
+	{
+		m_string += static_cast<char>(0xE0 | (codePoint >> 12));
+		m_string += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+		m_string += static_cast<char>(0x80 | (codePoint & 0x3F));
+	}
+	else
+	{
+		m_string += static_cast<char>(0xF0 | (codePoint >> 18));
+		m_string += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+		m_string += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+		m_string += static_cast<char>(0x80 | (codePoint & 0x3F));
+	}
 	return EResult::Success;
 }
 
-#pragma endregion
-
-minipp::MiniPPFile::Section::~Section()
+void minipp::MiniPPFile::JsonReader::ReadToken() noexcept
 {
-	for (auto& pair : m_values)
-		delete pair.second;
-	for (auto& pair : m_subSections)
-		delete pair.second;
+	// numbers and literals: everything up to the next delimiter, validated by the caller
+	m_string.clear();
+	while (true)
+	{
+		int c = Peek();
+		if (c < 0 || c == ',' || c == '}' || c == ']' || c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '"' || c == ':')
+			return;
+		m_string += static_cast<char>(c);
+		++m_position;
+	}
 }
 
-minipp::EResult minipp::MiniPPFile::Section::GetSubSection(const std::string& key, Section** destination) const noexcept
+minipp::EResult minipp::MiniPPFile::JsonReader::CheckName(const String& name) const noexcept
 {
-	auto pathIndex = key.find('.');
-	std::string thisKey = key;
-	std::string rest;
-	if (pathIndex != std::string::npos)
+	if (name.empty())
 	{
-		thisKey = key.substr(0, pathIndex);
-		rest = key.substr(pathIndex + 1);
+		PP_COUT_SYNTAX_ERROR_LINE(m_line, "Empty JSON member names are not allowed");
+		return EResult::KeyEmpty;
+	}
+	if (!Tools::IsNameValid(name))
+	{
+		PP_COUT_SYNTAX_ERROR_LINE(m_line, "Invalid member name. (\"" << name << "\") May only contain [a - z][A - Z][0 - 9] and _.");
+		return EResult::InvalidName;
 	}
+	return EResult::Success;
+}
 
-	auto it = m_subSections.find(thisKey);
-	if (it == m_subSections.end())
+// Builds the Section tree for ImportJson
+class minipp::MiniPPFile::JsonTreeBuilder
+{
+private:
+	Vector<Section*> m_sections;
+	Vector<Values::ArrayValue*> m_arrays;
+
+	template<typename ValueDataType, typename... Args>
+	EResult Add(const String* name, ValueDataType** destination, Args&&... args) noexcept
 	{
-		PP_COUT_SYNTAX_ERROR("Sub-Section not found: " << thisKey);
-		return EResult::SectionNotPresent;
+		if (name != nullptr)
+		{
+			auto result = m_sections.back()->EmplaceValue(*name, destination, std::forward<Args>(args)...);
+			if (result == EResult::KeyAlreadyPresent)
+				PP_COUT_SYNTAX_ERROR("Key already present: " << *name);
+			return result;
+		}
+
+		auto& elements = m_arrays.back()->GetValue();
+		if (!elements.empty() && elements.front()->GetType() != ValueDataType::Type)
+			return EResult::ArrayDataTypeInconsistency;
+		auto value = new ValueDataType(std::forward<Args>(args)...);
+		elements.push_back(value);
+		if (destination != nullptr)
+			*destination = value;
+		return EResult::Success;
 	}
-	if (rest.empty())
+
+public:
+	explicit JsonTreeBuilder(Section& root) { m_sections.push_back(&root); }
+
+	EResult OnBeginSection(const String& name) noexcept
 	{
-		*destination = it->second;
+		Section* section = nullptr;
+		auto result = m_sections.back()->EmplaceSubSection(name, &section);
+		if (!IsResultOk(result))
+		{
+			PP_COUT_SYNTAX_ERROR("All (sub-) sections may only be defined once: " << name);
+			return result;
+		}
+		m_sections.push_back(section);
 		return EResult::Success;
 	}
 
-	return it->second->GetSubSection(rest, destination);
-}
+	EResult OnEndSection() noexcept
+	{
+		m_sections.pop_back();
+		return EResult::Success;
+	}
 
-minipp::EResult minipp::MiniPPFile::Section::SetSubSection(const std::string& name, std::unique_ptr<Section> value, bool allowOverwrite) noexcept
-{
-	if (m_subSections.find(name) != m_subSections.end())
-		if (!allowOverwrite)
-			return EResult::SectionAlreadyPresent;
-		else
-			delete m_subSections[name];
+	EResult OnBeginArray(const String* name) noexcept
+	{
+		Values::ArrayValue* array = nullptr;
+		auto result = Add(name, &array);
+		if (IsResultOk(result))
+			m_arrays.push_back(array);
+		return result;
+	}
 
-	m_subSections[name] = value.release();
+	EResult OnEndArray() noexcept
+	{
+		m_arrays.pop_back();
+		return EResult::Success;
+	}
 
-	return EResult::Success;
-}
+	EResult OnInt(const String* name, int64_t value) noexcept { return Add<Values::IntValue>(name, nullptr, value); }
+	EResult OnFloat(const String* name, double value) noexcept { return Add<Values::FloatValue>(name, nullptr, value); }
+	EResult OnBoolean(const String* name, bool value) noexcept { return Add<Values::BooleanValue>(name, nullptr, value); }
+	EResult OnString(const String* name, const String& value) noexcept { return Add<Values::StringValue>(name, nullptr, value); }
+};
 
-minipp::EResult minipp::MiniPPFile::WriteSection(const Section* section, std::ofstream& ofs, std::string partTreeName) noexcept
+// Feeds ImportJson(input, writer). Top-level objects are written right away; every nested object gets
+// its own MiniWriter over a string that is spliced into its parent's output once the parent object ended.
+class minipp::MiniPPFile::JsonMiniConverter
 {
-	if (section->m_values.size() > 0)
+private:
+	struct DeferredSection
 	{
-		std::string valueString;
-		for (const auto& pair : section->m_values)
-		{
-			if (!Tools::IsNameValid(pair.first))
-			{
-				PP_COUT_SYNTAX_ERROR("Invalid name for key: " << pair.first);
-				return EResult::InvalidName;
-			}
+		String text;
+		StringSink sink{ text };
+		MiniWriter writer{ sink, 4 * 1024 };
+	};
 
-			for (const auto& comment : pair.second->m_comments)
-				ofs << comment << std::endl;
+	struct Frame
+	{
+		String path;
+		MiniWriter* writer = nullptr;
+		Vector<std::unique_ptr<DeferredSection>> children;
+	};
 
-			ofs << pair.first << " = ";
-			auto result = pair.second->ToString(valueString);
-			if (!IsResultOk(result))
-				return result;
-			ofs << valueString << std::endl;
-		}
-		ofs << std::endl;
-	}
+	MiniWriter& m_output;
+	Vector<Frame> m_frames;
 
-	if (!partTreeName.empty())
-		partTreeName += ".";
+	MiniWriter& Current() noexcept { return *m_frames.back().writer; }
 
-	for (const auto& pair : section->m_subSections)
+public:
+	explicit JsonMiniConverter(MiniWriter& output) noexcept : m_output(output) {}
+
+	EResult OnBeginSection(const String& name) noexcept
 	{
-		if (!Tools::IsNameValid(pair.first))
+		Frame frame;
+		if (m_frames.empty())
 		{
-			PP_COUT_SYNTAX_ERROR("Invalid name for section: " << pair.first);
-			return EResult::InvalidName;
+			frame.path = name;
+			frame.writer = &m_output;
 		}
+		else
+		{
+			Frame& parent = m_frames.back();
+			frame.path = parent.path + "." + name;
+			parent.children.push_back(std::make_unique<DeferredSection>());
+			frame.writer = &parent.children.back()->writer;
+		}
+		m_frames.push_back(std::move(frame));
+		return Current().BeginSection(m_frames.back().path);
+	}
 
-		for (const auto& comment : pair.second->m_comments)
-			ofs << comment << std::endl;
-
-		ofs << "[" << partTreeName << pair.first << "]" << std::endl;
-		auto result = WriteSection(pair.second, ofs, partTreeName + pair.first);
-		if (!IsResultOk(result))
-			return result;
+	EResult OnEndSection() noexcept
+	{
+		Frame& frame = m_frames.back();
+		for (auto& child : frame.children)
+		{
+			auto result = child->writer.Flush();
+			if (IsResultOk(result))
+				result = frame.writer->AppendSections(child->text.data(), child->text.size());
+			if (!IsResultOk(result))
+				return result;
+			child.reset();
+		}
+		m_frames.pop_back();
+		return EResult::Success;
 	}
 
-	return EResult::Success;
-}
+	EResult OnBeginArray(const String* name) noexcept { return name != nullptr ? Current().BeginArray(*name) : Current().BeginArray(); }
+	EResult OnEndArray() noexcept { return Current().EndArray(); }
 
-minipp::EResult minipp::MiniPPFile::Parse(const std::string& path, bool additional) noexcept
-{
-	std::ifstream ifs;
-	ifs.open(path);
-	return Parse(ifs, additional);
-}
+	EResult OnInt(const String* name, int64_t value) noexcept { return name != nullptr ? Current().Key(*name, value) : Current().Element(value); }
+	EResult OnFloat(const String* name, double value) noexcept { return name != nullptr ? Current().Key(*name, value) : Current().Element(value); }
+	EResult OnBoolean(const String* name, bool value) noexcept { return name != nullptr ? Current().Key(*name, value) : Current().Element(value); }
+	EResult OnString(const String* name, const String& value) noexcept { return name != nullptr ? Current().Key(*name, value) : Current().Element(value); }
+};
 
-minipp::EResult minipp::MiniPPFile::Parse(std::ifstream& ifs, bool additional) noexcept
+minipp::EResult minipp::MiniPPFile::ImportJson(std::istream& input, bool additional) noexcept
 {
-#define PP_COUT_HERE() PP_COUT_SYNTAX_ERROR_LINE(lineCounter, currentLine << " <- HERE");
 	if (!additional)
 	{
-		m_rootSection.m_comments.clear();
-		m_rootSection.m_values.clear();
-		m_rootSection.m_subSections.clear();
+		InvalidateHandles();
+		m_defaultsTable.clear();
+		m_rootSection.Clear();
 	}
 
-	if (!ifs.is_open())
+#if MINIPP_ENABLE_VALUE_POOL
+	ValuePool::Scope poolScope(m_valuePool != nullptr ? m_valuePool : ValuePool::GetCurrent());
+#endif
+#if MINIPP_USE_PMR
+	ResourceScope resourceScope(m_memoryResource);
+#endif
+
+	if (!input)
 		return EResult::FileIOError;
 
-	int64_t lineCounter = 0;
-	Section* currentSection = nullptr;
+	JsonReader reader(input);
+	JsonTreeBuilder builder(m_rootSection);
+	auto result = reader.ParseDocument(builder);
+	RefreshHandles();
+	return result;
+}
+
+minipp::EResult minipp::MiniPPFile::ImportJson(std::istream& input, MiniWriter& writer) noexcept
+{
+	if (!input)
+		return EResult::FileIOError;
+
+	JsonReader reader(input);
+	JsonMiniConverter converter(writer);
+	auto result = reader.ParseDocument(converter);
+	if (!IsResultOk(result))
+		return result;
+	return writer.Flush();
+}
+
+#pragma endregion
+
+#pragma region Codecs
+minipp::MiniPPFile::DecodingStreamBuffer::DecodingStreamBuffer(std::istream& source, std::unique_ptr<Decoder> decoder, size_t bufferSize)
+	: m_source(source), m_decoder(std::move(decoder)), m_input(bufferSize), m_output(bufferSize)
+{
+	setg(m_output.data(), m_output.data(), m_output.data());
+}
 
-	std::vector<std::string> commentBuffer;
+minipp::MiniPPFile::DecodingStreamBuffer::int_type minipp::MiniPPFile::DecodingStreamBuffer::underflow()
+{
+	if (gptr() < egptr())
+		return traits_type::to_int_type(*gptr());
 
-	std::string currentLine;
-	while (std::getline(ifs, currentLine))
+	while (!m_finished && IsResultOk(m_result))
 	{
-		++lineCounter;
-		Tools::StringTrim(currentLine);
-		if (currentLine.empty())
-			continue;
-		char firstChar = currentLine[0];
-		char lastChar = currentLine[currentLine.size() - 1];
+		if (m_inputBegin == m_inputEnd)
+		{
+			m_source.read(m_input.data(), static_cast<std::streamsize>(m_input.size()));
+			m_inputBegin = 0;
+			m_inputEnd = static_cast<size_t>(m_source.gcount());
+			if (m_inputEnd == 0)
+			{
+				PP_COUT("Compressed input ends in the middle of the stream");
+				m_result = m_source.bad() ? EResult::FileIOError : EResult::FormatError;
+				break;
+			}
+		}
 
-		if (firstChar == '#')
+		size_t consumed = 0;
+		size_t produced = 0;
+		m_result = m_decoder->Decode(m_input.data() + m_inputBegin, m_inputEnd - m_inputBegin, &consumed,
+			m_output.data(), m_output.size(), &produced, &m_finished);
+		m_inputBegin += consumed;
+		if (produced != 0)
 		{
-			commentBuffer.push_back(currentLine);
-			continue;
+			setg(m_output.data(), m_output.data(), m_output.data() + produced);
+			return traits_type::to_int_type(*gptr());
 		}
+		if (consumed == 0 && !m_finished && IsResultOk(m_result))
+			m_result = EResult::FormatError; // no progress
+	}
+	return traits_type::eof();
+}
 
-		if (firstChar == '[')
+namespace minipp
+{
+	namespace detail
+	{
+#if MINIPP_WITH_ZLIB
+		class GzipDecoder : public MiniPPFile::Decoder
 		{
-			if (lastChar != ']')
+		private:
+			z_stream m_stream{};
+
+		public:
+			bool Init() noexcept { return inflateInit2(&m_stream, 15 + 32) == Z_OK; } // gzip or zlib header
+			~GzipDecoder() { inflateEnd(&m_stream); }
+
+			EResult Decode(const char* input, size_t inputSize, size_t* consumed,
+				char* output, size_t outputSize, size_t* produced, bool* finished) noexcept override
 			{
-				PP_COUT_SYNTAX_ERROR("Expected ']' at the end of the line.");
-				PP_COUT_HERE();
-				return EResult::SectionExpectedClosingBracket;
+				uInt inputLimit = static_cast<uInt>(std::min<size_t>(inputSize, std::numeric_limits<uInt>::max()));
+				uInt outputLimit = static_cast<uInt>(std::min<size_t>(outputSize, std::numeric_limits<uInt>::max()));
+				m_stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input));
+				m_stream.avail_in = inputLimit;
+				m_stream.next_out = reinterpret_cast<Bytef*>(output);
+				m_stream.avail_out = outputLimit;
+				int status = inflate(&m_stream, Z_NO_FLUSH);
+				*consumed = inputLimit - m_stream.avail_in;
+				*produced = outputLimit - m_stream.avail_out;
+				*finished = status == Z_STREAM_END;
+				if (status == Z_OK || status == Z_STREAM_END || status == Z_BUF_ERROR)
+					return EResult::Success;
+				PP_COUT("gzip: " << (m_stream.msg != nullptr ? m_stream.msg : "corrupt input"));
+				return EResult::FormatError;
 			}
-			std::string sectionPathStr = currentLine.substr(1, currentLine.size() - 2);
-			Tools::StringTrim(sectionPathStr);
-			if (sectionPathStr.empty())
+		};
+
+		class GzipEncoder : public MiniPPFile::Encoder
+		{
+		private:
+			z_stream m_stream{};
+			char m_buffer[64 * 1024];
+
+			EResult Pump(int flush, MiniPPFile::OutputSink& sink) noexcept
 			{
-				PP_COUT_SYNTAX_ERROR("Expected section path. Found empty section begin notation.");
-				PP_COUT_HERE();
-				return EResult::EmptySectionName;
+				int status;
+				do
+				{
+					m_stream.next_out = reinterpret_cast<Bytef*>(m_buffer);
+					m_stream.avail_out = sizeof(m_buffer);
+					status = deflate(&m_stream, flush);
+					if (status == Z_STREAM_ERROR)
+						return EResult::FormatError;
+					size_t produced = sizeof(m_buffer) - m_stream.avail_out;
+					if (produced != 0)
+					{
+						auto result = sink.Write(m_buffer, produced);
+						if (!MiniPPFile::IsResultOk(result))
+							return result;
+					}
+				} while (m_stream.avail_out == 0 || (flush == Z_FINISH && status != Z_STREAM_END));
+				return EResult::Success;
 			}
-			// Create section tree
-			Section* ubSection = &m_rootSection;
 
-			std::vector<std::string> sectionPath = Tools::SplitByDelimiter(sectionPathStr, '.');
-			EResult result;
-			for (size_t i = 0; i < sectionPath.size(); ++i)
+		public:
+			bool Init() noexcept { return deflateInit2(&m_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK; }
+			~GzipEncoder() { deflateEnd(&m_stream); }
+
+			EResult Encode(const char* data, size_t size, MiniPPFile::OutputSink& sink) noexcept override
 			{
-				const std::string& sectionName = sectionPath[i];
-				if (!Tools::IsNameValid(sectionName))
+				while (size != 0)
 				{
-					PP_COUT_SYNTAX_ERROR("Invalid section name. (\"" << sectionName << "\") May only contain [a - z][A - Z][0 - 9] and _.");
-					PP_COUT_HERE();
-					return EResult::InvalidName;
+					uInt slice = static_cast<uInt>(std::min<size_t>(size, std::numeric_limits<uInt>::max()));
+					m_stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+					m_stream.avail_in = slice;
+					auto result = Pump(Z_NO_FLUSH, sink);
+					if (!MiniPPFile::IsResultOk(result))
+						return result;
+					data += slice;
+					size -= slice;
 				}
+				return EResult::Success;
+			}
 
-				result = ubSection->SetSubSection(sectionName, std::make_unique<Section>(), false);
-				if (result == EResult::SectionAlreadyPresent && i == sectionPath.size() - 1)
+			EResult Finish(MiniPPFile::OutputSink& sink) noexcept override
+			{
+				m_stream.next_in = nullptr;
+				m_stream.avail_in = 0;
+				return Pump(Z_FINISH, sink);
+			}
+		};
+#endif
+
+#if MINIPP_WITH_ZSTD
+		class ZstdDecoder : public MiniPPFile::Decoder
+		{
+		private:
+			ZSTD_DCtx* m_context = ZSTD_createDCtx();
+
+		public:
+			bool Init() noexcept { return m_context != nullptr; }
+			~ZstdDecoder() { ZSTD_freeDCtx(m_context); }
+
+			EResult Decode(const char* input, size_t inputSize, size_t* consumed,
+				char* output, size_t outputSize, size_t* produced, bool* finished) noexcept override
+			{
+				ZSTD_inBuffer in{ input, inputSize, 0 };
+				ZSTD_outBuffer out{ output, outputSize, 0 };
+				size_t status = ZSTD_decompressStream(m_context, &out, &in);
+				*consumed = in.pos;
+				*produced = out.pos;
+				if (ZSTD_isError(status))
 				{
-					PP_COUT_SYNTAX_ERROR("All (sub-) sections may only be defined once.");
-					PP_COUT_HERE();
-					return EResult::SectionAlreadyPresent;
+					PP_COUT("zstd: " << ZSTD_getErrorName(status));
+					return EResult::FormatError;
 				}
-				ubSection->GetSubSection(sectionName, &ubSection);
+				*finished = status == 0;
+				return EResult::Success;
 			}
-			currentSection = ubSection;
-			currentSection->m_comments = commentBuffer;
-			commentBuffer.clear();
-			continue;
-		}
-		if (currentSection == nullptr)
+		};
+
+		class ZstdEncoder : public MiniPPFile::Encoder
+		{
+		private:
+			ZSTD_CCtx* m_context = ZSTD_createCCtx();
+			char m_buffer[64 * 1024];
+
+			EResult Pump(ZSTD_inBuffer& in, ZSTD_EndDirective directive, MiniPPFile::OutputSink& sink) noexcept
+			{
+				while (true)
+				{
+					ZSTD_outBuffer out{ m_buffer, sizeof(m_buffer), 0 };
+					size_t remaining = ZSTD_compressStream2(m_context, &out, &in, directive);
+					if (ZSTD_isError(remaining))
+					{
+						PP_COUT("zstd: " << ZSTD_getErrorName(remaining));
+						return EResult::FormatError;
+					}
+					if (out.pos != 0)
+					{
+						auto result = sink.Write(m_buffer, out.pos);
+						if (!MiniPPFile::IsResultOk(result))
+							return result;
+					}
+					bool done = directive == ZSTD_e_end ? remaining == 0 : in.pos == in.size;
+					if (done)
+						return EResult::Success;
+				}
+			}
+
+		public:
+			bool Init() noexcept { return m_context != nullptr; }
+			~ZstdEncoder() { ZSTD_freeCCtx(m_context); }
+
+			EResult Encode(const char* data, size_t size, MiniPPFile::OutputSink& sink) noexcept override
+			{
+				ZSTD_inBuffer in{ data, size, 0 };
+				return Pump(in, ZSTD_e_continue, sink);
+			}
+
+			EResult Finish(MiniPPFile::OutputSink& sink) noexcept override
+			{
+				ZSTD_inBuffer in{ nullptr, 0, 0 };
+				return Pump(in, ZSTD_e_end, sink);
+			}
+		};
+#endif
+
+		// nullptr if the codec couldn't set up its state
+		template<typename Base, typename Implementation>
+		std::unique_ptr<Base> CreateCodecObject()
 		{
-			PP_COUT_SYNTAX_ERROR("Expected section begin before key-value pair.");
-			PP_COUT_HERE();
-			return EResult::KeyValuePairNotInSection;
+			auto object = std::make_unique<Implementation>();
+			if (!object->Init())
+				return nullptr;
+			return std::unique_ptr<Base>(std::move(object));
 		}
 
-		int64_t keyValueDelimiterIndex = Tools::FirstIndexOf(currentLine, '=');
-		if (keyValueDelimiterIndex == -1)
+		struct CodecRegistry
 		{
-			PP_COUT_SYNTAX_ERROR("Expected '=' in line.");
-			PP_COUT_HERE();
-			return EResult::ExpectedKeyValuePair;
-		}
+			std::mutex mutex;
+			std::vector<MiniPPFile::Codec> codecs;
 
-		auto keyValuePair = Tools::SplitInTwo(currentLine, keyValueDelimiterIndex);
-		Tools::StringTrim(keyValuePair.first);
-		Tools::StringTrim(keyValuePair.second);
+			CodecRegistry()
+			{
+				// registered either way, so compressed files aren't mistaken for text without the codec compiled in
+				MiniPPFile::Codec gzip;
+				gzip.extension = ".gz";
+#if MINIPP_WITH_ZLIB
+				gzip.createDecoder = &CreateCodecObject<MiniPPFile::Decoder, GzipDecoder>;
+				gzip.createEncoder = &CreateCodecObject<MiniPPFile::Encoder, GzipEncoder>;
+#endif
+				codecs.push_back(gzip);
 
-		if (keyValuePair.first.empty())
+				MiniPPFile::Codec zstd;
+				zstd.extension = ".zst";
+#if MINIPP_WITH_ZSTD
+				zstd.createDecoder = &CreateCodecObject<MiniPPFile::Decoder, ZstdDecoder>;
+				zstd.createEncoder = &CreateCodecObject<MiniPPFile::Encoder, ZstdEncoder>;
+#endif
+				codecs.push_back(zstd);
+			}
+		};
+
+		inline CodecRegistry& GetCodecRegistry()
 		{
-			PP_COUT_SYNTAX_ERROR("Expected key in line.");
-			PP_COUT_HERE();
-			return EResult::KeyEmpty;
+			static CodecRegistry registry;
+			return registry;
 		}
-		if (!Tools::IsNameValid(keyValuePair.first))
+	}
+}
+
+void minipp::MiniPPFile::RegisterCodec(const Codec& codec)
+{
+	auto& registry = detail::GetCodecRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	for (auto& registered : registry.codecs)
+	{
+		if (registered.extension == codec.extension)
 		{
-			PP_COUT_SYNTAX_ERROR("Invalid key name. (\"" << keyValuePair.first << "\") May only contain [a - z][A - Z][0 - 9] and _.");
-			PP_COUT_HERE();
-			return EResult::InvalidName;
+			registered = codec;
+			return;
 		}
+	}
+	registry.codecs.push_back(codec);
+}
 
-		if (keyValuePair.second.empty())
+bool minipp::MiniPPFile::FindCodec(const std::string& path, Codec* destination)
+{
+	auto& registry = detail::GetCodecRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	for (const auto& codec : registry.codecs)
+	{
+		const auto& extension = codec.extension;
+		if (!extension.empty() && path.size() > extension.size() &&
+			path.compare(path.size() - extension.size(), extension.size(), extension.data(), extension.size()) == 0)
 		{
-			PP_COUT_SYNTAX_ERROR("Empty keys are not allowed");
-			PP_COUT_HERE();
-			return EResult::ValueEmpty;
+			*destination = codec;
+			return true;
 		}
-		EResult parseResult;
-		auto parsedValue = Value::ParseValue(keyValuePair.second, &parseResult);
-		if (parsedValue == nullptr)
+	}
+	return false;
+}
+#pragma endregion
+
+#pragma region Writer
+
+minipp::EResult minipp::MiniPPFile::StreamSink::Write(const char* data, size_t size) noexcept
+{
+	m_stream.write(data, static_cast<std::streamsize>(size));
+	return m_stream.fail() ? EResult::FileIOError : EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::StreamSink::Flush() noexcept
+{
+	m_stream.flush();
+	return m_stream.fail() ? EResult::FileIOError : EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::StringSink::Write(const char* data, size_t size) noexcept
+{
+	m_destination.append(data, size);
+	return EResult::Success;
+}
+
+minipp::MiniPPFile::MiniWriter::MiniWriter(OutputSink& sink, size_t bufferSize)
+	: m_sink(sink), m_bufferSize(bufferSize)
+{
+	m_buffer.reserve(bufferSize);
+}
+
+minipp::MiniPPFile::MiniWriter::~MiniWriter()
+{
+	Flush();
+}
+
+minipp::EResult minipp::MiniPPFile::MiniWriter::Flush() noexcept
+{
+	if (!IsResultOk(m_error))
+		return m_error;
+
+	if (!m_buffer.empty())
+	{
+		m_error = m_sink.Write(m_buffer.data(), m_buffer.size());
+		m_buffer.clear();
+		m_commentStart = String::npos;
+		if (!IsResultOk(m_error))
+			return m_error;
+	}
+	m_error = m_sink.Flush();
+	return m_error;
+}
+
+minipp::EResult minipp::MiniPPFile::MiniWriter::Finish() noexcept
+{
+	if (!m_arrays.empty())
+	{
+		PP_COUT_SYNTAX_ERROR("MiniWriter finished with " << m_arrays.size() << " open array(s).");
+		return EResult::ArrayNotEnclosed;
+	}
+	return Flush();
+}
+
+minipp::EResult minipp::MiniPPFile::MiniWriter::BeginSection(const String& path) noexcept
+{
+	if (!IsResultOk(m_error))
+		return m_error;
+	if (!m_arrays.empty())
+		return EResult::ArrayNotEnclosed;
+	if (path.empty())
+		return EResult::EmptySectionName;
+
+	size_t begin = 0;
+	while (begin <= path.size())
+	{
+		size_t end = path.find('.', begin);
+		if (end == String::npos)
+			end = path.size();
+		if (end == begin || !Tools::IsNameValid(path.substr(begin, end - begin)))
 		{
-			PP_COUT_HERE();
-			return parseResult;
+			PP_COUT_SYNTAX_ERROR("Invalid section path: " << path);
+			return EResult::InvalidName;
 		}
-		parsedValue->m_comments = commentBuffer;
-		commentBuffer.clear();
+		begin = end + 1;
+	}
 
-		auto valueSetResult = currentSection->SetValue(keyValuePair.first, std::move(parsedValue), false);
-		if (valueSetResult != EResult::Success)
+	// like Write: one blank line after the values of a section, in front of the comments of the next one
+	if (m_sectionHasValues)
+	{
+		if (m_commentStart != String::npos)
+			m_buffer.insert(m_commentStart, 1, '\n');
+		else
+			m_buffer += '\n';
+	}
+	m_commentStart = String::npos;
+	m_buffer += '[';
+	m_buffer += path;
+	m_buffer += "]\n";
+	m_inSection = true;
+	m_sectionHasValues = false;
+	return FlushIfFull();
+}
+
+minipp::EResult minipp::MiniPPFile::MiniWriter::Comment(const String& text) noexcept
+{
+	if (!IsResultOk(m_error))
+		return m_error;
+	if (!m_arrays.empty())
+		return EResult::ArrayNotEnclosed;
+
+	if (m_commentStart == String::npos)
+		m_commentStart = m_buffer.size();
+
+	size_t begin = 0;
+	while (true)
+	{
+		size_t end = text.find('\n', begin);
+		m_buffer += "# ";
+		m_buffer.append(text, begin, end == String::npos ? String::npos : end - begin);
+		m_buffer += '\n';
+		if (end == String::npos)
+			break;
+		begin = end + 1;
+	}
+	return FlushIfFull();
+}
+
+minipp::EResult minipp::MiniPPFile::MiniWriter::AppendSections(const char* text, size_t size) noexcept
+{
+	if (!IsResultOk(m_error))
+		return m_error;
+	if (!m_arrays.empty())
+		return EResult::ArrayNotEnclosed;
+	if (size == 0)
+		return EResult::Success;
+
+	if (m_sectionHasValues)
+		m_buffer += '\n';
+	m_buffer.append(text, size);
+	m_commentStart = String::npos;
+	m_inSection = true;
+	m_sectionHasValues = true; // blank line in front of whatever section follows
+	return FlushIfFull();
+}
+
+minipp::EResult minipp::MiniPPFile::MiniWriter::BeginValue(const String* name, EValueType type) noexcept
+{
+	if (!IsResultOk(m_error))
+		return m_error;
+
+	if (name != nullptr)
+	{
+		if (!m_arrays.empty())
+			return EResult::ArrayNotEnclosed;
+		if (!m_inSection)
+			return EResult::KeyValuePairNotInSection;
+		if (name->empty())
+			return EResult::KeyEmpty;
+		if (!Tools::IsNameValid(*name))
 		{
-			PP_COUT_SYNTAX_ERROR("Key already present: " << keyValuePair.first);
-			PP_COUT_HERE();
-			return valueSetResult;
+			PP_COUT_SYNTAX_ERROR("Invalid name for key: " << *name);
+			return EResult::InvalidName;
 		}
+
+		m_buffer += *name;
+		m_buffer += " = ";
+		return EResult::Success;
 	}
 
+	if (m_arrays.empty())
+		return EResult::ExpectedKeyValuePair;
+
+	ArrayLevel& level = m_arrays.back();
+	if (level.count != 0)
+	{
+		if (level.elementType != type)
+			return EResult::ArrayDataTypeInconsistency;
+		m_buffer += ", ";
+	}
+	level.elementType = type;
+	++level.count;
 	return EResult::Success;
 }
 
-minipp::EResult minipp::MiniPPFile::Write(const std::string& path) const noexcept
+minipp::EResult minipp::MiniPPFile::MiniWriter::EndValue() noexcept
 {
-	std::ofstream ofs;
-	ofs.open(path);
+	// elements and nested arrays end inside the line of their key
+	if (m_arrays.empty())
+	{
+		m_buffer += '\n';
+		m_sectionHasValues = true;
+		m_commentStart = String::npos;
+	}
+	return FlushIfFull();
+}
 
-	return Write(ofs);
+minipp::EResult minipp::MiniPPFile::MiniWriter::FlushIfFull() noexcept
+{
+	if (m_buffer.size() >= m_bufferSize)
+	{
+		m_error = m_sink.Write(m_buffer.data(), m_buffer.size());
+		m_buffer.clear();
+		m_commentStart = String::npos;
+	}
+	return m_error;
 }
 
-minipp::EResult minipp::MiniPPFile::Write(std::ofstream& ofs) const noexcept
+minipp::EResult minipp::MiniPPFile::MiniWriter::WriteInt(const String* name, int64_t value, EIntStyle style) noexcept
 {
-	if (!ofs.is_open())
-		return EResult::FileIOError;
+	auto result = BeginValue(name, EValueType::Int);
+	if (!IsResultOk(result))
+		return result;
+	result = Tools::AppendInt(m_buffer, value, style);
+	if (!IsResultOk(result))
+		return result;
+	return EndValue();
+}
 
-	return WriteSection(&m_rootSection, ofs, "");
+minipp::EResult minipp::MiniPPFile::MiniWriter::WriteFloat(const String* name, double value) noexcept
+{
+	auto result = BeginValue(name, EValueType::Float);
+	if (!IsResultOk(result))
+		return result;
+	Tools::AppendFloat(m_buffer, value);
+	return EndValue();
 }
 
-bool minipp::MiniPPFile::IsResultOk(EResult result) noexcept
+minipp::EResult minipp::MiniPPFile::MiniWriter::WriteBoolean(const String* name, bool value) noexcept
 {
-	return static_cast<int32_t>(result) > 0;
+	auto result = BeginValue(name, EValueType::Boolean);
+	if (!IsResultOk(result))
+		return result;
+	m_buffer += value ? "true" : "false";
+	return EndValue();
+}
+
+minipp::EResult minipp::MiniPPFile::MiniWriter::WriteString(const String* name, const char* value, size_t size) noexcept
+{
+	auto result = BeginValue(name, EValueType::String);
+	if (!IsResultOk(result))
+		return result;
+	Tools::AppendEscapedString(m_buffer, value, size);
+	return EndValue();
+}
+
+minipp::EResult minipp::MiniPPFile::MiniWriter::BeginArray(const String& name) noexcept
+{
+	auto result = BeginValue(&name, EValueType::Array);
+	if (!IsResultOk(result))
+		return result;
+	m_arrays.emplace_back();
+	m_buffer += '[';
+	return EResult::Success;
+}
+
+minipp::EResult minipp::MiniPPFile::MiniWriter::BeginArray() noexcept
+{
+	auto result = BeginValue(nullptr, EValueType::Array);
+	if (!IsResultOk(result))
+		return result;
+	m_arrays.emplace_back();
+	m_buffer += '[';
+	return EResult::Success;
 }
 
+minipp::EResult minipp::MiniPPFile::MiniWriter::EndArray() noexcept
+{
+	if (!IsResultOk(m_error))
+		return m_error;
+	if (m_arrays.empty())
+		return EResult::ArrayBracketsInbalanced;
+
+	m_arrays.pop_back();
+	m_buffer += ']';
+	return EndValue();
+}
+
+#pragma endregion
+
 #pragma region Tools
-bool minipp::MiniPPFile::Tools::StringStartsWith(const std::string& str, const std::string& beg)
+bool minipp::MiniPPFile::Tools::StringStartsWith(const String& str, const String& beg)
 {
 	if (str.size() < beg.size())
 		return false;
@@ -1040,7 +7418,7 @@ bool minipp::MiniPPFile::Tools::StringStartsWith(const std::string& str, const s
 	return true;
 }
 
-bool minipp::MiniPPFile::Tools::StringEndsWith(const std::string& str, const std::string& end)
+bool minipp::MiniPPFile::Tools::StringEndsWith(const String& str, const String& end)
 {
 	if (str.size() < end.size())
 		return false;
@@ -1052,7 +7430,7 @@ bool minipp::MiniPPFile::Tools::StringEndsWith(const std::string& str, const std
 	return true;
 }
 
-void minipp::MiniPPFile::Tools::StringTrim(std::string& str)
+void minipp::MiniPPFile::Tools::StringTrim(String& str)
 {
 	if (str.empty())
 		return;
@@ -1066,7 +7444,7 @@ void minipp::MiniPPFile::Tools::StringTrim(std::string& str)
 	str = str.substr(start, end - start + 1);
 }
 
-bool minipp::MiniPPFile::Tools::IsNameValid(const std::string& name) noexcept
+bool minipp::MiniPPFile::Tools::IsNameValid(const String& name) noexcept
 {
 	for (const char c : name)
 	{
@@ -1082,7 +7460,7 @@ bool minipp::MiniPPFile::Tools::IsNameValid(const std::string& name) noexcept
 	return true;
 }
 
-int64_t minipp::MiniPPFile::Tools::FirstIndexOf(const std::string& str, char c) noexcept
+int64_t minipp::MiniPPFile::Tools::FirstIndexOf(const String& str, char c) noexcept
 {
 	int64_t index = 0;
 	for (const char ch : str)
@@ -1095,7 +7473,7 @@ int64_t minipp::MiniPPFile::Tools::FirstIndexOf(const std::string& str, char c)
 	return -1;
 }
 
-int64_t minipp::MiniPPFile::Tools::LastIndexOf(const std::string& str, char c) noexcept
+int64_t minipp::MiniPPFile::Tools::LastIndexOf(const String& str, char c) noexcept
 {
 	int64_t index = str.size() - 1;
 	for (int64_t i = str.size() - 1; i >= 0; --i)
@@ -1108,15 +7486,15 @@ int64_t minipp::MiniPPFile::Tools::LastIndexOf(const std::string& str, char c) n
 	return -1;
 }
 
-std::pair<std::string, std::string> minipp::MiniPPFile::Tools::SplitInTwo(const std::string& str, int64_t firstLength) noexcept
+std::pair<minipp::String, minipp::String> minipp::MiniPPFile::Tools::SplitInTwo(const String& str, int64_t firstLength) noexcept
 {
 	return std::make_pair(str.substr(0, firstLength), str.substr(firstLength + 1));
 }
 
-std::vector<std::string> minipp::MiniPPFile::Tools::SplitByDelimiter(const std::string& str, char delimiter) noexcept
+minipp::Vector<minipp::String> minipp::MiniPPFile::Tools::SplitByDelimiter(const String& str, char delimiter) noexcept
 {
-	std::vector<std::string> elements;
-	std::string tmp;
+	Vector<String> elements;
+	String tmp;
 
 	for (const char c : str)
 	{
@@ -1135,12 +7513,12 @@ std::vector<std::string> minipp::MiniPPFile::Tools::SplitByDelimiter(const std::
 	return elements;
 }
 
-void minipp::MiniPPFile::Tools::RemoveAll(std::string& str, char old)
+void minipp::MiniPPFile::Tools::RemoveAll(String& str, char old)
 {
 	str.erase(std::remove(str.begin(), str.end(), old), str.end());
 }
 
-bool minipp::MiniPPFile::Tools::IsIntegerDecimal(const std::string& str) noexcept
+bool minipp::MiniPPFile::Tools::IsIntegerDecimal(const String& str) noexcept
 {
 	for (size_t i = 0; i < str.size(); ++i)
 		if (str[i] < '0' || str[i] > '9')
@@ -1149,5 +7527,234 @@ bool minipp::MiniPPFile::Tools::IsIntegerDecimal(const std::string& str) noexcep
 	return true;
 }
 
+minipp::MiniPPFile::Tools::ENumericClass minipp::MiniPPFile::Tools::ClassifyNumeric(const char* data, size_t size) noexcept
+{
+	return detail::GetKernels().classifyNumeric(data, size);
+}
+
+size_t minipp::MiniPPFile::Tools::FindFirstOf(const char* data, size_t size, const char* set, size_t setSize) noexcept
+{
+	if (setSize > 16) // the vector kernels keep the whole set in registers
+		return detail::FindFirstOfScalar(data, size, set, setSize);
+	return detail::GetKernels().findFirstOf(data, size, set, setSize);
+}
+
+size_t minipp::MiniPPFile::Tools::ParseDigits(const char* data, size_t size, uint64_t* value) noexcept
+{
+	return detail::GetKernels().parseDigits(data, size, value);
+}
+
+void minipp::MiniPPFile::Tools::AppendEscapedString(String& destination, const char* data, size_t size)
+{
+	static const char escapedChars[] = { '\n', '\t', '\r', '\\', '\"' };
+
+	destination.reserve(destination.size() + size + 2);
+	destination.push_back('"');
+
+	size_t i = 0;
+	while (i < size)
+	{
+		size_t next = i + FindFirstOf(data + i, size - i, escapedChars, sizeof(escapedChars));
+		destination.append(data + i, next - i);
+		if (next == size)
+			break;
+
+		switch (data[next])
+		{
+		case '\n':
+			destination += "\\n";
+			break;
+		case '\t':
+			destination += "\\t";
+			break;
+		case '\r':
+			destination += "\\r";
+			break;
+		case '\\':
+			destination += "\\\\";
+			break;
+		case '\"':
+			destination += "\\\"";
+			break;
+		default: break;
+		}
+		i = next + 1;
+	}
+
+	destination.push_back('"');
+}
+
+minipp::EResult minipp::MiniPPFile::Tools::AppendInt(String& destination, int64_t value, EIntStyle style)
+{
+	// hexadecimal and binary print the two's complement bits without leading zeros, like std::hex / std::bitset did
+	char buffer[66];
+	char* end = buffer + sizeof(buffer);
+	char* cursor = end;
+	switch (style)
+	{
+	case EIntStyle::Decimal:
+	{
+		uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+		do
+		{
+			*--cursor = static_cast<char>('0' + magnitude % 10);
+			magnitude /= 10;
+		} while (magnitude != 0);
+		if (value < 0)
+			*--cursor = '-';
+		break;
+	}
+	case EIntStyle::Hexadecimal:
+	{
+		*--cursor = 'h';
+		uint64_t bits = static_cast<uint64_t>(value);
+		do
+		{
+			*--cursor = "0123456789abcdef"[bits & 0xF];
+			bits >>= 4;
+		} while (bits != 0);
+		break;
+	}
+	case EIntStyle::Binary:
+	{
+		*--cursor = 'b';
+		uint64_t bits = static_cast<uint64_t>(value);
+		do
+		{
+			*--cursor = static_cast<char>('0' + (bits & 1));
+			bits >>= 1;
+		} while (bits != 0);
+		break;
+	}
+	default:
+		PP_COUT_SYNTAX_ERROR("Invalid integer style.");
+		return EResult::IntegerStyleInvalid;
+	}
+
+	destination.append(cursor, end);
+	return EResult::Success;
+}
+
+void minipp::MiniPPFile::Tools::AppendJsonString(String& destination, const char* data, size_t size)
+{
+	static const char hexDigits[] = "0123456789abcdef";
+
+	destination.reserve(destination.size() + size + 2);
+	destination.push_back('"');
+
+	size_t runStart = 0;
+	for (size_t i = 0; i < size; ++i)
+	{
+		unsigned char c = static_cast<unsigned char>(data[i]);
+		if (c >= 0x20 && c != '"' && c != '\\')
+			continue;
+
+		destination.append(data + runStart, i - runStart);
+		runStart = i + 1;
+		switch (c)
+		{
+		case '"': destination += "\\\""; break;
+		case '\\': destination += "\\\\"; break;
+		case '\n': destination += "\\n"; break;
+		case '\t': destination += "\\t"; break;
+		case '\r': destination += "\\r"; break;
+		case '\b': destination += "\\b"; break;
+		case '\f': destination += "\\f"; break;
+		default:
+			destination += "\\u00";
+			destination += hexDigits[c >> 4];
+			destination += hexDigits[c & 0xF];
+			break;
+		}
+	}
+	destination.append(data + runStart, size - runStart);
+
+	destination.push_back('"');
+}
+
+void minipp::MiniPPFile::Tools::AppendJsonFloat(String& destination, double value)
+{
+	if (!std::isfinite(value))
+	{
+		destination += "null";
+		return;
+	}
+
+	// shortest of the two precisions that still reads back as the same double
+	char buffer[32];
+	int length = std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+	if (std::strtod(buffer, nullptr) != value)
+		length = std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+	destination.append(buffer, static_cast<size_t>(length));
+}
+
+size_t minipp::MiniPPFile::Tools::MeasureEscapedString(const char* data, size_t size) noexcept
+{
+	static const char escapedChars[] = { '\n', '\t', '\r', '\\', '\"' };
+
+	// quotes plus one extra backslash per escaped character
+	size_t length = size + 2;
+	size_t i = 0;
+	while (i < size)
+	{
+		i += FindFirstOf(data + i, size - i, escapedChars, sizeof(escapedChars));
+		if (i == size)
+			break;
+		++length;
+		++i;
+	}
+	return length;
+}
+
+size_t minipp::MiniPPFile::Tools::MeasureInt(int64_t value, EIntStyle style) noexcept
+{
+	size_t length = 0;
+	switch (style)
+	{
+	case EIntStyle::Decimal:
+	{
+		uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+		length = value < 0 ? 1 : 0;
+		do
+		{
+			++length;
+			magnitude /= 10;
+		} while (magnitude != 0);
+		return length;
+	}
+	case EIntStyle::Hexadecimal:
+	case EIntStyle::Binary:
+	{
+		unsigned shift = style == EIntStyle::Hexadecimal ? 4 : 1;
+		uint64_t bits = static_cast<uint64_t>(value);
+		length = 1; // 'h' / 'b' suffix
+		do
+		{
+			++length;
+			bits >>= shift;
+		} while (bits != 0);
+		return length;
+	}
+	default:
+		return 0;
+	}
+}
+
+size_t minipp::MiniPPFile::Tools::MeasureFloat(double value) noexcept
+{
+	int length = std::snprintf(nullptr, 0, "%f", value);
+	return (length > 0 ? static_cast<size_t>(length) : 0) + 1;
+}
+
+void minipp::MiniPPFile::Tools::AppendFloat(String& destination, double value)
+{
+	// same text as std::to_string (%f), without the temporary string
+	char buffer[512];
+	int length = std::snprintf(buffer, sizeof(buffer), "%f", value);
+	if (length > 0)
+		destination.append(buffer, std::min(static_cast<size_t>(length), sizeof(buffer) - 1));
+	destination.push_back('f');
+}
+
 #pragma endregion
 #endif // MINIPP_IMPLEMENTATION
\ No newline at end of file